@@ -0,0 +1,308 @@
+//
+//  arena.h
+//  BasicOpenGL
+//
+
+#ifndef arena_h
+#define arena_h
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+
+#include <vertexformat.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+//Large vertex and index buffers that meshes are suballocated from. Meshes of one vertex format share the
+//pools of that format and with them a vertex array, so drawing one after the other needs no vertex array
+//bind: they tell their data apart by base vertex and index offset. Full pools are not grown, growing
+//would move every mesh in them and the vertex arrays instance batches built over their buffers would
+//have to follow. Another pool of the format is opened instead.
+
+//vertex and index bytes of a pool, a mesh larger than that gets a pool of its own size
+const size_t ARENA_VERTEX_BYTES = 8 << 20;
+const size_t ARENA_INDEX_BYTES = 4 << 20;
+//index ranges start at multiples of this, the largest index type
+const size_t ARENA_INDEX_ALIGNMENT = 4;
+
+//index bytes rounded up to the alignment, what an index range takes from its pool
+inline size_t arenaIndexSpan(size_t bytes) {
+    return (bytes + ARENA_INDEX_ALIGNMENT - 1) / ARENA_INDEX_ALIGNMENT * ARENA_INDEX_ALIGNMENT;
+}
+
+//first fit allocator over [0, capacity), free ranges are merged with their neighbours when freed
+class FreeList {
+public:
+    static const size_t NONE = ~size_t(0);
+    explicit FreeList(size_t capacity = 0) : capacity(capacity) {
+        if (capacity) { ranges[0] = capacity; }
+    }
+    //offset of a free range of size units starting at a multiple of alignment, NONE if there is none
+    size_t allocate(size_t size, size_t alignment = 1) {
+        if (!size) { return 0; }
+        for (auto it = ranges.begin(); it != ranges.end(); it++) {
+            size_t start = (it->first + alignment - 1) / alignment * alignment, end = it->first + it->second;
+            if (start + size > end) { continue; }
+            size_t first = it->first;
+            ranges.erase(it);
+            if (start > first) { ranges[first] = start - first; }
+            if (end > start + size) { ranges[start + size] = end - start - size; }
+            return start;
+        }
+        return NONE;
+    }
+    void free(size_t offset, size_t size) {
+        if (!size) { return; }
+        auto next = ranges.lower_bound(offset);
+        if (next != ranges.end() && offset + size == next->first) {
+            size += next->second;
+            next = ranges.erase(next);
+        }
+        if (next != ranges.begin()) {
+            auto previous = prev(next);
+            if (previous->first + previous->second == offset) {
+                previous->second += size;
+                return;
+            }
+        }
+        ranges[offset] = size;
+    }
+    //everything below used is taken, the rest is one free range
+    void reset(size_t used) {
+        ranges.clear();
+        if (used < capacity) { ranges[used] = capacity - used; }
+    }
+    size_t freeSize() const {
+        size_t total = 0;
+        for (auto it = ranges.begin(); it != ranges.end(); it++) { total += it->second; }
+        return total;
+    }
+    size_t largest() const {
+        size_t best = 0;
+        for (auto it = ranges.begin(); it != ranges.end(); it++) { best = max(best, it->second); }
+        return best;
+    }
+    size_t blocks() const { return ranges.size(); }
+    size_t capacity;
+private:
+    //offset to size of every free range
+    map<size_t, size_t> ranges;
+};
+
+//buffers and vertex array of one vertex format, see GeometryArena
+struct ArenaPool {
+    unsigned int format;
+    GLuint vao, vbo, ebo;
+    //in vertices
+    FreeList vertices;
+    //in bytes
+    FreeList indices;
+};
+
+//where a mesh lives in the arena. The arena owns it and keeps it up to date when compact moves the mesh
+struct ArenaAllocation {
+    ArenaPool* pool;
+    //the mesh's vertices start at first_vertex, its indices count from there
+    unsigned int first_vertex, vertex_count;
+    //byte range of the mesh's indices in the index buffer
+    size_t index_offset, index_bytes;
+};
+
+//how full and how fragmented the arena is, sizes in bytes
+struct ArenaStats {
+    unsigned int pools, allocations;
+    size_t vertex_capacity, vertex_used, index_capacity, index_used;
+    //free ranges, and the largest one of any pool
+    unsigned int free_blocks;
+    size_t largest_free;
+    //share of the free bytes outside the largest free range of their buffer. 0 when every buffer has
+    //one free range, close to 1 when the free space is scattered in small holes
+    float fragmentation;
+};
+
+class GeometryArena {
+    typedef unsigned int uint;
+public:
+    GeometryArena() : scratch(0), scratch_size(0) {}
+    //pools are freed by clear and trim, not on destruction, the GL context may be gone by then
+
+    //room for vertex_count vertices of format and index_bytes of indices
+    ArenaAllocation* allocate(uint format, uint vertex_count, size_t index_bytes) {
+        uint stride = VertexLayout(format).stride;
+        for (uint i = 0; i < pools.size(); i++) {
+            if (pools[i]->format != format) { continue; }
+            ArenaAllocation* a = place(pools[i], vertex_count, index_bytes);
+            if (a) { return a; }
+        }
+        ArenaPool* pool = createPool(format, max(ARENA_VERTEX_BYTES / stride, size_t(vertex_count)), max(ARENA_INDEX_BYTES, index_bytes));
+        return place(pool, vertex_count, index_bytes);
+    }
+    void free(ArenaAllocation* a) {
+        if (!a || !live.erase(a)) { return; }
+        a->pool->vertices.free(a->first_vertex, a->vertex_count);
+        a->pool->indices.free(a->index_offset, arenaIndexSpan(a->index_bytes));
+        delete a;
+    }
+    //move the allocations of every pool to its front, so each buffer is left with a single free range.
+    //Draws read the new offsets from the allocations. Returns the bytes moved
+    size_t compact() {
+        size_t moved = 0;
+        for (uint p = 0; p < pools.size(); p++) {
+            ArenaPool* pool = pools[p];
+            uint stride = VertexLayout(pool->format).stride;
+            vector<ArenaAllocation*> in_pool;
+            for (auto it = live.begin(); it != live.end(); it++) {
+                if ((*it)->pool == pool) { in_pool.push_back(*it); }
+            }
+            sort(in_pool.begin(), in_pool.end(), [](const ArenaAllocation* a, const ArenaAllocation* b) { return a->first_vertex < b->first_vertex; });
+            size_t end = 0;
+            for (uint i = 0; i < in_pool.size(); i++) {
+                ArenaAllocation* a = in_pool[i];
+                if (a->first_vertex != end) {
+                    move(pool->vbo, size_t(a->first_vertex) * stride, end * stride, size_t(a->vertex_count) * stride);
+                    moved += size_t(a->vertex_count) * stride;
+                    a->first_vertex = end;
+                }
+                end += a->vertex_count;
+            }
+            pool->vertices.reset(end);
+            sort(in_pool.begin(), in_pool.end(), [](const ArenaAllocation* a, const ArenaAllocation* b) { return a->index_offset < b->index_offset; });
+            end = 0;
+            for (uint i = 0; i < in_pool.size(); i++) {
+                ArenaAllocation* a = in_pool[i];
+                if (a->index_offset != end) {
+                    move(pool->ebo, a->index_offset, end, a->index_bytes);
+                    moved += a->index_bytes;
+                    a->index_offset = end;
+                }
+                end += arenaIndexSpan(a->index_bytes);
+            }
+            pool->indices.reset(end);
+        }
+        return moved;
+    }
+    ArenaStats stats() const {
+        ArenaStats s = {uint(pools.size()), uint(live.size()), 0, 0, 0, 0, 0, 0, 0.0f};
+        size_t free_total = 0, scattered = 0;
+        for (uint i = 0; i < pools.size(); i++) {
+            const ArenaPool* pool = pools[i];
+            size_t stride = VertexLayout(pool->format).stride;
+            size_t vertex_free = pool->vertices.freeSize() * stride, index_free = pool->indices.freeSize();
+            s.vertex_capacity += pool->vertices.capacity * stride;
+            s.vertex_used += pool->vertices.capacity * stride - vertex_free;
+            s.index_capacity += pool->indices.capacity;
+            s.index_used += pool->indices.capacity - index_free;
+            s.free_blocks += pool->vertices.blocks() + pool->indices.blocks();
+            s.largest_free = max(s.largest_free, max(pool->vertices.largest() * stride, pool->indices.largest()));
+            free_total += vertex_free + index_free;
+            scattered += vertex_free - pool->vertices.largest() * stride + index_free - pool->indices.largest();
+        }
+        if (free_total) { s.fragmentation = float(scattered) / free_total; }
+        return s;
+    }
+    //delete the pools nothing is allocated from
+    void trim() {
+        set<ArenaPool*> used;
+        for (auto it = live.begin(); it != live.end(); it++) { used.insert((*it)->pool); }
+        for (uint i = 0; i < pools.size();) {
+            if (used.count(pools[i])) {
+                i++;
+                continue;
+            }
+            destroyPool(pools[i]);
+            pools.erase(pools.begin() + i);
+        }
+        if (pools.empty() && scratch) {
+            glDeleteBuffers(1, &scratch);
+            scratch = 0;
+            scratch_size = 0;
+        }
+    }
+    //free every pool, whether meshes still live in them or not
+    void clear() {
+        for (auto it = live.begin(); it != live.end(); it++) { delete *it; }
+        live.clear();
+        trim();
+    }
+    //arena the meshes allocate from unless told otherwise, see Mesh::arena
+    static GeometryArena& shared() {
+        static GeometryArena arena;
+        return arena;
+    }
+
+private:
+    vector<ArenaPool*> pools;
+    set<ArenaAllocation*> live;
+    //staging for moves within one buffer, whose source and destination may overlap
+    GLuint scratch;
+    size_t scratch_size;
+
+    ArenaAllocation* place(ArenaPool* pool, uint vertex_count, size_t index_bytes) {
+        size_t first = pool->vertices.allocate(vertex_count);
+        if (first == FreeList::NONE) { return NULL; }
+        size_t offset = pool->indices.allocate(arenaIndexSpan(index_bytes), ARENA_INDEX_ALIGNMENT);
+        if (offset == FreeList::NONE) {
+            pool->vertices.free(first, vertex_count);
+            return NULL;
+        }
+        ArenaAllocation* a = new ArenaAllocation();
+        a->pool = pool;
+        a->first_vertex = uint(first);
+        a->vertex_count = vertex_count;
+        a->index_offset = offset;
+        a->index_bytes = index_bytes;
+        live.insert(a);
+        return a;
+    }
+    ArenaPool* createPool(uint format, size_t vertex_count, size_t index_bytes) {
+        ArenaPool* pool = new ArenaPool();
+        pool->format = format;
+        pool->vertices = FreeList(vertex_count);
+        pool->indices = FreeList(arenaIndexSpan(index_bytes));
+        glGenVertexArrays(1, &pool->vao);
+        glGenBuffers(1, &pool->vbo);
+        glGenBuffers(1, &pool->ebo);
+        glBindVertexArray(pool->vao);
+        glBindBuffer(GL_ARRAY_BUFFER, pool->vbo);
+        glBufferData(GL_ARRAY_BUFFER, vertex_count * VertexLayout(format).stride, NULL, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, pool->indices.capacity, NULL, GL_STATIC_DRAW);
+        setupVertexAttributes(format);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        pools.push_back(pool);
+        return pool;
+    }
+    void destroyPool(ArenaPool* pool) {
+        glDeleteVertexArrays(1, &pool->vao);
+        glDeleteBuffers(1, &pool->vbo);
+        glDeleteBuffers(1, &pool->ebo);
+        delete pool;
+    }
+    //copy size bytes of buffer from one offset to another through the scratch buffer
+    void move(GLuint buffer, size_t from, size_t to, size_t size) {
+        if (!size) { return; }
+        if (size > scratch_size) {
+            if (!scratch) { glGenBuffers(1, &scratch); }
+            scratch_size = size;
+            glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+            glBufferData(GL_COPY_WRITE_BUFFER, scratch_size, NULL, GL_STREAM_COPY);
+        }
+        glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, scratch);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, from, 0, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, scratch);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, to, size);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+};
+
+#endif /* arena_h */
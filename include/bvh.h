@@ -0,0 +1,418 @@
+//
+//  bvh.h
+//  BasicOpenGL
+//
+
+#ifndef bvh_h
+#define bvh_h
+
+#include <glm/glm.hpp>
+
+#include <culling.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+//leaves are enlarged by BVH_MARGIN of their size plus BVH_MIN_MARGIN on every side, an object moving
+//within its enlarged box only updates its leaf and leaves the tree alone
+const float BVH_MARGIN = 0.1f;
+const float BVH_MIN_MARGIN = 0.05f;
+
+//shape of a DynamicBvh
+struct BvhStats {
+    unsigned int leaves, nodes;
+    //longest path from the root to a leaf, about log2(leaves) when the tree is balanced
+    unsigned int height;
+    //surface area of the inner nodes over the surface area of the root, what a random ray or query
+    //pays per unit of root area. Lower is a better tree
+    float area_ratio;
+};
+
+//Dynamic bounding volume hierarchy over axis aligned boxes, after the dynamic tree of Box2D. Every object
+//is a leaf holding its box and a copy enlarged by the margins, inner nodes bound their two children.
+//Leaves are inserted next to the sibling that grows the surface area of the tree least and the path up
+//is rebalanced by rotations, so the tree stays about log2(n) deep under any order of updates. Moving an
+//object refits its leaf, it is only reinserted once it leaves its enlarged box.
+//Nodes are addressed by index, insert returns the leaf of an object, which stays valid until removed.
+class DynamicBvh {
+    typedef unsigned int uint;
+public:
+    static const uint NONE = ~0u;
+
+    DynamicBvh() : root(NONE), free_list(NONE), leaves(0) {}
+
+    //add object with box [lo, hi], returns its leaf
+    uint insert(uint object, const glm::vec3& lo, const glm::vec3& hi) {
+        uint leaf = allocate();
+        Node& n = nodes[leaf];
+        n.object = object;
+        n.height = 0;
+        setBox(leaf, lo, hi);
+        insertLeaf(leaf);
+        leaves++;
+        return leaf;
+    }
+    void remove(uint leaf) {
+        removeLeaf(leaf);
+        release(leaf);
+        leaves--;
+    }
+    //give the object of leaf the box [lo, hi], true if it left its enlarged box and was reinserted
+    bool move(uint leaf, const glm::vec3& lo, const glm::vec3& hi) {
+        Node& n = nodes[leaf];
+        if (glm::all(glm::greaterThanEqual(lo, n.lo)) && glm::all(glm::lessThanEqual(hi, n.hi))) {
+            n.tight_lo = lo;
+            n.tight_hi = hi;
+            return false;
+        }
+        removeLeaf(leaf);
+        setBox(leaf, lo, hi);
+        insertLeaf(leaf);
+        return true;
+    }
+    void clear() {
+        nodes.clear();
+        root = free_list = NONE;
+        leaves = 0;
+    }
+    uint size() const {
+        return leaves;
+    }
+    uint object(uint leaf) const {
+        return nodes[leaf].object;
+    }
+
+    //objects whose boxes are at least partly inside planes, inward facing as FrameContext::frustum. Inner
+    //nodes inside a plane drop it for their subtree, subtrees inside all planes are taken without tests
+    CullStats queryFrustum(const glm::vec4 planes[6], vector<uint>& out) const {
+        CullStats stats = {leaves, 0, 0, 0};
+        out.clear();
+        if (root == NONE) { return stats; }
+        vector<pair<uint, uint> > stack(1, make_pair(root, 0x3Fu));
+        while (!stack.empty()) {
+            uint index = stack.back().first, mask = stack.back().second;
+            stack.pop_back();
+            const Node& n = nodes[index];
+            stats.nodes++;
+            bool leaf = n.height == 0;
+            //leaves are tested with their own box, inner nodes with the box around their children
+            glm::vec3 lo = leaf ? n.tight_lo : n.lo, hi = leaf ? n.tight_hi : n.hi;
+            glm::vec3 center = (lo + hi) * 0.5f, extent = (hi - lo) * 0.5f;
+            bool outside = false;
+            for (uint p = 0; p < 6 && !outside; p++) {
+                if (!(mask & (1u << p))) { continue; }
+                glm::vec3 normal = glm::vec3(planes[p]);
+                float distance = glm::dot(normal, center) + planes[p].w, reach = glm::dot(glm::abs(normal), extent);
+                if (distance + reach < 0.0f) {
+                    outside = true;
+                } else if (distance - reach >= 0.0f) {
+                    mask &= ~(1u << p);
+                }
+            }
+            if (outside) { continue; }
+            if (leaf) {
+                out.push_back(n.object);
+            } else if (!mask) {
+                collect(index, out);
+            } else {
+                stack.push_back(make_pair(n.child[0], mask));
+                stack.push_back(make_pair(n.child[1], mask));
+            }
+        }
+        stats.visible = out.size();
+        stats.culled = leaves - stats.visible;
+        return stats;
+    }
+    //whether the box of the object of leaf is at least partly inside planes, what queryFrustum decides for it
+    bool inFrustum(uint leaf, const glm::vec4 planes[6]) const {
+        const Node& n = nodes[leaf];
+        glm::vec3 center = (n.tight_lo + n.tight_hi) * 0.5f, extent = (n.tight_hi - n.tight_lo) * 0.5f;
+        for (uint p = 0; p < 6; p++) {
+            glm::vec3 normal = glm::vec3(planes[p]);
+            if (glm::dot(normal, center) + planes[p].w + glm::dot(glm::abs(normal), extent) < 0.0f) { return false; }
+        }
+        return true;
+    }
+    //objects whose boxes overlap [lo, hi]
+    void queryBox(const glm::vec3& lo, const glm::vec3& hi, vector<uint>& out) const {
+        out.clear();
+        if (root == NONE) { return; }
+        vector<uint> stack(1, root);
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            if (!overlaps(n.lo, n.hi, lo, hi)) { continue; }
+            if (n.height == 0) {
+                if (overlaps(n.tight_lo, n.tight_hi, lo, hi)) { out.push_back(n.object); }
+            } else {
+                stack.push_back(n.child[0]);
+                stack.push_back(n.child[1]);
+            }
+        }
+    }
+    //objects whose boxes come within radius of center
+    void querySphere(const glm::vec3& center, float radius, vector<uint>& out) const {
+        out.clear();
+        if (root == NONE) { return; }
+        float limit = radius * radius;
+        vector<uint> stack(1, root);
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            if (distance2(center, n.lo, n.hi) > limit) { continue; }
+            if (n.height == 0) {
+                if (distance2(center, n.tight_lo, n.tight_hi) <= limit) { out.push_back(n.object); }
+            } else {
+                stack.push_back(n.child[0]);
+                stack.push_back(n.child[1]);
+            }
+        }
+    }
+    //the k objects whose boxes are nearest to point, nearest first, 0 apart when point is inside a box.
+    //Nodes are opened nearest first and the search ends once the next node is farther than the k-th object
+    void queryNearest(const glm::vec3& point, uint k, vector<uint>& out) const {
+        out.clear();
+        if (root == NONE || !k) { return; }
+        typedef pair<float, uint> Entry;
+        priority_queue<Entry, vector<Entry>, greater<Entry> > open;
+        //the nearest objects found so far, farthest on top
+        priority_queue<Entry> found;
+        open.push(Entry(distance2(point, nodes[root].lo, nodes[root].hi), root));
+        while (!open.empty()) {
+            Entry next = open.top();
+            open.pop();
+            if (found.size() == k && next.first > found.top().first) { break; }
+            const Node& n = nodes[next.second];
+            if (n.height == 0) {
+                float d = distance2(point, n.tight_lo, n.tight_hi);
+                if (found.size() < k) {
+                    found.push(Entry(d, n.object));
+                } else if (d < found.top().first) {
+                    found.pop();
+                    found.push(Entry(d, n.object));
+                }
+            } else {
+                for (uint c = 0; c < 2; c++) {
+                    const Node& child = nodes[n.child[c]];
+                    open.push(Entry(distance2(point, child.lo, child.hi), n.child[c]));
+                }
+            }
+        }
+        out.resize(found.size());
+        for (uint i = out.size(); i-- > 0; found.pop()) { out[i] = found.top().second; }
+    }
+
+    BvhStats stats() const {
+        BvhStats s = {leaves, 0, 0, 0.0f};
+        if (root == NONE) { return s; }
+        s.height = uint(nodes[root].height);
+        float inner = 0.0f;
+        vector<uint> stack(1, root);
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            s.nodes++;
+            if (n.height == 0) { continue; }
+            inner += area(n.lo, n.hi);
+            stack.push_back(n.child[0]);
+            stack.push_back(n.child[1]);
+        }
+        float whole = area(nodes[root].lo, nodes[root].hi);
+        s.area_ratio = whole > 0.0f ? inner / whole : 0.0f;
+        return s;
+    }
+
+private:
+    struct Node {
+        //the enlarged box of a leaf, the box around the children of an inner node
+        glm::vec3 lo, hi;
+        //the object's own box, leaves only
+        glm::vec3 tight_lo, tight_hi;
+        //parent, or the next free node while the node is free
+        uint parent;
+        uint child[2];
+        //0 for leaves, -1 while free
+        int height;
+        uint object;
+    };
+    vector<Node> nodes;
+    uint root, free_list;
+    uint leaves;
+
+    static float area(const glm::vec3& lo, const glm::vec3& hi) {
+        glm::vec3 d = hi - lo;
+        return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+    }
+    static bool overlaps(const glm::vec3& alo, const glm::vec3& ahi, const glm::vec3& blo, const glm::vec3& bhi) {
+        return glm::all(glm::lessThanEqual(alo, bhi)) && glm::all(glm::lessThanEqual(blo, ahi));
+    }
+    //squared distance from p to the box [lo, hi]
+    static float distance2(const glm::vec3& p, const glm::vec3& lo, const glm::vec3& hi) {
+        glm::vec3 d = glm::max(glm::max(lo - p, p - hi), glm::vec3(0.0f));
+        return glm::dot(d, d);
+    }
+    void setBox(uint leaf, const glm::vec3& lo, const glm::vec3& hi) {
+        Node& n = nodes[leaf];
+        glm::vec3 margin = (hi - lo) * BVH_MARGIN + glm::vec3(BVH_MIN_MARGIN);
+        n.tight_lo = lo;
+        n.tight_hi = hi;
+        n.lo = lo - margin;
+        n.hi = hi + margin;
+    }
+    uint allocate() {
+        if (free_list == NONE) {
+            nodes.push_back(Node());
+            nodes.back().height = -1;
+            free_list = nodes.size() - 1;
+            nodes.back().parent = NONE;
+        }
+        uint index = free_list;
+        free_list = nodes[index].parent;
+        Node& n = nodes[index];
+        n.parent = n.child[0] = n.child[1] = NONE;
+        n.height = 0;
+        n.object = NONE;
+        return index;
+    }
+    void release(uint index) {
+        nodes[index].parent = free_list;
+        nodes[index].height = -1;
+        free_list = index;
+    }
+    //append the objects of every leaf below index
+    void collect(uint index, vector<uint>& out) const {
+        vector<uint> stack(1, index);
+        while (!stack.empty()) {
+            const Node& n = nodes[stack.back()];
+            stack.pop_back();
+            if (n.height == 0) {
+                out.push_back(n.object);
+            } else {
+                stack.push_back(n.child[0]);
+                stack.push_back(n.child[1]);
+            }
+        }
+    }
+    void insertLeaf(uint leaf) {
+        if (root == NONE) {
+            root = leaf;
+            nodes[leaf].parent = NONE;
+            return;
+        }
+        glm::vec3 lo = nodes[leaf].lo, hi = nodes[leaf].hi;
+        //walk down to the sibling: going into a child makes every node on the way grow, pairing with the
+        //current node instead costs a new parent around both
+        uint index = root;
+        while (nodes[index].height > 0) {
+            const Node& n = nodes[index];
+            float here = area(n.lo, n.hi);
+            float combined = area(glm::min(n.lo, lo), glm::max(n.hi, hi));
+            float cost = 2.0f * combined;
+            float inherited = 2.0f * (combined - here);
+            float child_cost[2];
+            for (uint c = 0; c < 2; c++) {
+                const Node& child = nodes[n.child[c]];
+                float grown = area(glm::min(child.lo, lo), glm::max(child.hi, hi));
+                child_cost[c] = (child.height == 0 ? grown : grown - area(child.lo, child.hi)) + inherited;
+            }
+            if (cost < child_cost[0] && cost < child_cost[1]) { break; }
+            index = child_cost[0] < child_cost[1] ? n.child[0] : n.child[1];
+        }
+        uint sibling = index;
+        uint old_parent = nodes[sibling].parent;
+        uint parent = allocate();
+        Node& p = nodes[parent];
+        p.parent = old_parent;
+        p.lo = glm::min(nodes[sibling].lo, lo);
+        p.hi = glm::max(nodes[sibling].hi, hi);
+        p.height = nodes[sibling].height + 1;
+        p.child[0] = sibling;
+        p.child[1] = leaf;
+        nodes[sibling].parent = parent;
+        nodes[leaf].parent = parent;
+        if (old_parent == NONE) {
+            root = parent;
+        } else {
+            Node& op = nodes[old_parent];
+            op.child[op.child[0] == sibling ? 0 : 1] = parent;
+        }
+        refit(parent);
+    }
+    void removeLeaf(uint leaf) {
+        if (leaf == root) {
+            root = NONE;
+            return;
+        }
+        uint parent = nodes[leaf].parent, grandparent = nodes[parent].parent;
+        uint sibling = nodes[parent].child[nodes[parent].child[0] == leaf ? 1 : 0];
+        release(parent);
+        if (grandparent == NONE) {
+            root = sibling;
+            nodes[sibling].parent = NONE;
+            return;
+        }
+        Node& g = nodes[grandparent];
+        g.child[g.child[0] == parent ? 0 : 1] = sibling;
+        nodes[sibling].parent = grandparent;
+        refit(grandparent);
+    }
+    //rebalance and rebound the nodes from index up to the root
+    void refit(uint index) {
+        while (index != NONE) {
+            index = balance(index);
+            Node& n = nodes[index];
+            const Node& a = nodes[n.child[0]];
+            const Node& b = nodes[n.child[1]];
+            n.height = 1 + max(a.height, b.height);
+            n.lo = glm::min(a.lo, b.lo);
+            n.hi = glm::max(a.hi, b.hi);
+            index = n.parent;
+        }
+    }
+    //rotate the taller child of a up when the heights of a's children differ by more than one, returns
+    //the node now in a's place
+    uint balance(uint a) {
+        Node& A = nodes[a];
+        if (A.height < 2) { return a; }
+        uint b = A.child[0], c = A.child[1];
+        int difference = nodes[c].height - nodes[b].height;
+        if (difference > 1) { return rotate(a, 1); }
+        if (difference < -1) { return rotate(a, 0); }
+        return a;
+    }
+    //make child side of a (call it c) the parent of a, the taller child of c stays below c and the other
+    //one takes c's place below a
+    uint rotate(uint a, uint side) {
+        uint c = nodes[a].child[side], other = nodes[a].child[1 - side];
+        uint f = nodes[c].child[0], g = nodes[c].child[1];
+        //c replaces a below a's parent
+        nodes[c].child[0] = a;
+        nodes[c].parent = nodes[a].parent;
+        nodes[a].parent = c;
+        if (nodes[c].parent == NONE) {
+            root = c;
+        } else {
+            Node& p = nodes[nodes[c].parent];
+            p.child[p.child[0] == a ? 0 : 1] = c;
+        }
+        uint keep = nodes[f].height > nodes[g].height ? f : g, give = keep == f ? g : f;
+        nodes[c].child[1] = keep;
+        nodes[a].child[side] = give;
+        nodes[give].parent = a;
+        nodes[a].lo = glm::min(nodes[other].lo, nodes[give].lo);
+        nodes[a].hi = glm::max(nodes[other].hi, nodes[give].hi);
+        nodes[a].height = 1 + max(nodes[other].height, nodes[give].height);
+        nodes[c].lo = glm::min(nodes[a].lo, nodes[keep].lo);
+        nodes[c].hi = glm::max(nodes[a].hi, nodes[keep].hi);
+        nodes[c].height = 1 + max(nodes[a].height, nodes[keep].height);
+        return c;
+    }
+};
+
+#endif /* bvh_h */
@@ -48,9 +48,12 @@ public:
     float MovementSpeed;
     float MouseSensitivity;
     float Zoom;
+    // Incremented whenever the position, orientation or zoom changes so renderers can skip re-uploading an unchanged camera.
+    // The Process* methods and setters below keep it current, code that writes the attributes directly must increment it too
+    unsigned int Version;
     
     // Constructor with vectors
-    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), Version(0)
     {
         Position = position;
         WorldUp = up;
@@ -59,7 +62,7 @@ public:
         updateCameraVectors();
     }
     // Constructor with scalar values
-    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
+    Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), Version(0)
     {
         Position = glm::vec3(posX, posY, posZ);
         WorldUp = glm::vec3(upX, upY, upZ);
@@ -74,10 +77,35 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
     
+    // Moves the camera to position
+    void SetPosition(glm::vec3 position)
+    {
+        Position = position;
+        Version++;
+    }
+    
+    // Turns the camera to the given Euler angles, in degrees
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = glm::mod(yaw, 360.0f);
+        Pitch = pitch;
+        updateCameraVectors();
+        Version++;
+    }
+    
+    // Sets the field of view, in degrees, within the range the scroll wheel allows
+    void SetZoom(float zoom)
+    {
+        Zoom = glm::clamp(zoom, 1.0f, 45.0f);
+        Version++;
+    }
+    
     // Processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
         float velocity = MovementSpeed * deltaTime;
+        if (velocity != 0.0f)
+            Version++;
         if (direction == FORWARD)
             Position += Front * velocity;
         if (direction == BACKWARD)
@@ -111,6 +139,7 @@ public:
         Yaw = glm::mod(Yaw, 360.0f);
         // Update Front, Right and Up Vectors using the updated Euler angles
         updateCameraVectors();
+        Version++;
     }
     
     // Processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
@@ -122,6 +151,7 @@ public:
             Zoom = 1.0f;
         if (Zoom >= 45.0f)
             Zoom = 45.0f;
+        Version++;
     }
     
 private:
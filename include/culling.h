@@ -0,0 +1,129 @@
+//
+//  culling.h
+//  BasicOpenGL
+//
+
+#ifndef culling_h
+#define culling_h
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define CULL_SSE 1
+#endif
+
+using namespace std;
+
+//what the last frustum test found
+struct CullStats {
+    unsigned int tested, visible, culled;
+    //bounding volume hierarchy nodes visited, see DynamicBvh::queryFrustum. 0 for FrustumCuller
+    unsigned int nodes;
+};
+
+//the world space box around the box [lo, hi] transformed by model, after Arvo
+inline void transformBox(const glm::mat4& model, const glm::vec3& lo, const glm::vec3& hi, glm::vec3& out_lo, glm::vec3& out_hi) {
+    glm::vec3 center = glm::vec3(model * glm::vec4((lo + hi) * 0.5f, 1.0f));
+    glm::vec3 half = (hi - lo) * 0.5f, extent(0.0f);
+    for (unsigned int j = 0; j < 3; j++) {
+        extent += glm::abs(glm::vec3(model[j])) * half[j];
+    }
+    out_lo = center - extent;
+    out_hi = center + extent;
+}
+
+//World space bounds of many objects tested against the view frustum. Every object has a bounding sphere
+//and an axis aligned box, each component in an array of its own so the SSE path tests four objects at
+//once. An object is culled when its sphere or its box lies entirely outside one of the planes, both are
+//conservative so nothing visible is culled.
+class FrustumCuller {
+    typedef unsigned int uint;
+public:
+    FrustumCuller() : count(0) {}
+
+    //hold n objects, their bounds are undefined until set
+    void resize(uint n) {
+        count = n;
+        //rounded up to whole groups of four so the SSE path reads no further, the padding is never reported
+        uint padded = (n + 3) & ~3u;
+        for (uint i = 0; i < COMPONENTS; i++) { soa[i].assign(padded, 0.0f); }
+    }
+    uint size() const {
+        return count;
+    }
+    //bounds of object i: the model space sphere and box transformed by model. The sphere grows by the
+    //largest scale of model, the box is the world box around the transformed one
+    void set(uint i, const glm::mat4& model, const glm::vec3& center, float radius, const glm::vec3& box_min, const glm::vec3& box_max) {
+        glm::vec3 c = glm::vec3(model * glm::vec4(center, 1.0f));
+        float scale = max(glm::length(glm::vec3(model[0])), max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        glm::vec3 lo, hi;
+        transformBox(model, box_min, box_max, lo, hi);
+        glm::vec3 box_center = (lo + hi) * 0.5f, extent = (hi - lo) * 0.5f;
+        soa[SPHERE_X][i] = c.x;
+        soa[SPHERE_Y][i] = c.y;
+        soa[SPHERE_Z][i] = c.z;
+        soa[SPHERE_R][i] = radius * scale;
+        soa[BOX_X][i] = box_center.x;
+        soa[BOX_Y][i] = box_center.y;
+        soa[BOX_Z][i] = box_center.z;
+        soa[EXTENT_X][i] = extent.x;
+        soa[EXTENT_Y][i] = extent.y;
+        soa[EXTENT_Z][i] = extent.z;
+    }
+    //write 1 to inside[i] for every object at least partly inside planes and 0 for the others. planes
+    //face inward, as FrameContext::frustum
+    CullStats cull(const glm::vec4 planes[6], vector<unsigned char>& inside) const {
+        inside.resize(count);
+        CullStats stats = {count, 0, 0, 0};
+        uint i = 0;
+#ifdef CULL_SSE
+        const float* x = soa[SPHERE_X].data(), *y = soa[SPHERE_Y].data(), *z = soa[SPHERE_Z].data(), *r = soa[SPHERE_R].data();
+        const float* bx = soa[BOX_X].data(), *by = soa[BOX_Y].data(), *bz = soa[BOX_Z].data();
+        const float* ex = soa[EXTENT_X].data(), *ey = soa[EXTENT_Y].data(), *ez = soa[EXTENT_Z].data();
+        __m128 zero = _mm_setzero_ps();
+        for (; i < count; i += 4) {
+            __m128 vx = _mm_loadu_ps(x + i), vy = _mm_loadu_ps(y + i), vz = _mm_loadu_ps(z + i), vr = _mm_loadu_ps(r + i);
+            __m128 vbx = _mm_loadu_ps(bx + i), vby = _mm_loadu_ps(by + i), vbz = _mm_loadu_ps(bz + i);
+            __m128 vex = _mm_loadu_ps(ex + i), vey = _mm_loadu_ps(ey + i), vez = _mm_loadu_ps(ez + i);
+            __m128 in = _mm_cmpeq_ps(zero, zero);
+            for (uint p = 0; p < 6; p++) {
+                __m128 nx = _mm_set1_ps(planes[p].x), ny = _mm_set1_ps(planes[p].y), nz = _mm_set1_ps(planes[p].z), w = _mm_set1_ps(planes[p].w);
+                __m128 ax = _mm_set1_ps(fabs(planes[p].x)), ay = _mm_set1_ps(fabs(planes[p].y)), az = _mm_set1_ps(fabs(planes[p].z));
+                __m128 sphere = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, vx), _mm_mul_ps(ny, vy)), _mm_add_ps(_mm_mul_ps(nz, vz), w)), vr);
+                __m128 box = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, vbx), _mm_mul_ps(ny, vby)), _mm_add_ps(_mm_mul_ps(nz, vbz), w)),
+                                        _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, vex), _mm_mul_ps(ay, vey)), _mm_mul_ps(az, vez)));
+                in = _mm_and_ps(in, _mm_and_ps(_mm_cmpge_ps(sphere, zero), _mm_cmpge_ps(box, zero)));
+            }
+            int mask = _mm_movemask_ps(in);
+            for (uint k = 0; k < 4 && i + k < count; k++) {
+                inside[i + k] = (mask >> k) & 1;
+                stats.visible += inside[i + k];
+            }
+        }
+#endif
+        for (; i < count; i++) {
+            bool in = true;
+            for (uint p = 0; p < 6; p++) {
+                float nx = planes[p].x, ny = planes[p].y, nz = planes[p].z, w = planes[p].w;
+                float sphere = ((nx * soa[SPHERE_X][i] + ny * soa[SPHERE_Y][i]) + (nz * soa[SPHERE_Z][i] + w)) + soa[SPHERE_R][i];
+                float box = ((nx * soa[BOX_X][i] + ny * soa[BOX_Y][i]) + (nz * soa[BOX_Z][i] + w)) + ((fabs(nx) * soa[EXTENT_X][i] + fabs(ny) * soa[EXTENT_Y][i]) + fabs(nz) * soa[EXTENT_Z][i]);
+                in = in && sphere >= 0.0f && box >= 0.0f;
+            }
+            inside[i] = in;
+            stats.visible += in;
+        }
+        stats.culled = count - stats.visible;
+        return stats;
+    }
+
+private:
+    enum Component {SPHERE_X, SPHERE_Y, SPHERE_Z, SPHERE_R, BOX_X, BOX_Y, BOX_Z, EXTENT_X, EXTENT_Y, EXTENT_Z, COMPONENTS};
+    uint count;
+    vector<float> soa[COMPONENTS];
+};
+
+#endif /* culling_h */
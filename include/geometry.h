@@ -0,0 +1,135 @@
+//
+//  geometry.h
+//  BasicOpenGL
+//
+
+#ifndef geometry_h
+#define geometry_h
+
+#include <primitive.h>
+
+#include <cstddef>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+//Reference counted store of primitive meshes.
+//Objects asking for the same primitive (same key and uv map) get the same mesh, so its vertices are
+//generated and uploaded once. Shared meshes must not be modified: modify() hands out a mesh private
+//to the caller first. A mesh's buffers are freed when its last user releases it.
+class GeometryCache {
+    typedef unsigned int uint;
+public:
+    GeometryCache() : hits(0), misses(0) {}
+
+    Primitive* acquire(const PrimitiveKey& key, Uvmap uvmap = NO_UVMAP) {
+        Key k = {key, uvmap};
+        auto found = shared.find(k);
+        if (found != shared.end()) {
+            entries[found->second].users++;
+            hits++;
+            return found->second;
+        }
+        misses++;
+        Primitive* mesh = create(k);
+        Entry entry = {k, 1, true};
+        entries[mesh] = entry;
+        shared[k] = mesh;
+        return mesh;
+    }
+    //drop one user of mesh, true if that was the last one and the mesh has been freed
+    bool release(Primitive* mesh) {
+        auto found = entries.find(mesh);
+        if (found == entries.end()) { return false; }
+        if (--found->second.users > 0) { return false; }
+        if (found->second.cached) { shared.erase(found->second.key); }
+        entries.erase(found);
+        mesh->release();
+        delete mesh;
+        return true;
+    }
+    //give mesh the uv map uv, shared meshes are swapped for the shared mesh with that uv map
+    Primitive* setUvmap(Primitive* mesh, Uvmap uv) {
+        auto found = entries.find(mesh);
+        if (found == entries.end()) { return mesh; }
+        if (!found->second.cached) {
+            found->second.key.uvmap = uv;
+            mesh->genUvmap(uv);
+            return mesh;
+        }
+        PrimitiveKey key = found->second.key.primitive;
+        release(mesh);
+        return acquire(key, uv);
+    }
+    //a mesh only the caller uses, equal to mesh, which it replaces. Textures are attached per mesh,
+    //so an object gets its own copy of the geometry before it is textured
+    Primitive* modify(Primitive* mesh) {
+        auto found = entries.find(mesh);
+        if (found == entries.end() || !found->second.cached) { return mesh; }
+        Key k = found->second.key;
+        Primitive* copy = create(k);
+        for (uint i = 0; i < mesh->textures.size(); i++) {
+            copy->addTexture(mesh->textures[i].id, mesh->textures[i].type);
+        }
+        Entry entry = {k, 1, false};
+        entries[copy] = entry;
+        release(mesh);
+        return copy;
+    }
+    //free every mesh, whether it still has users or not
+    void clear() {
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            it->first->release();
+            delete it->first;
+        }
+        entries.clear();
+        shared.clear();
+    }
+    //vertex and index data of all meshes alive
+    size_t gpuBytes() const {
+        size_t bytes = 0;
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            bytes += it->first->gpuBytes();
+        }
+        return bytes;
+    }
+    //the index buffer report of every mesh alive, one line each
+    string indexReport() const {
+        stringstream report;
+        for (auto it = entries.begin(); it != entries.end(); it++) {
+            report << "shape " << it->second.key.primitive.sh << " subd " << it->second.key.primitive.subd[0] << "x" << it->second.key.primitive.subd[1] << (it->second.cached ? "" : " (private)") << ": " << it->first->indexReport() << endl;
+        }
+        return report.str();
+    }
+    //meshes alive, and how many of them are shared through the cache
+    size_t size() const { return entries.size(); }
+    size_t sharedSize() const { return shared.size(); }
+    //acquire calls that found their mesh and that had to build it
+    uint hits, misses;
+
+private:
+    struct Key {
+        PrimitiveKey primitive;
+        Uvmap uvmap;
+        bool operator<(const Key& o) const {
+            if (uvmap != o.uvmap) { return uvmap < o.uvmap; }
+            return primitive < o.primitive;
+        }
+    };
+    struct Entry {
+        Key key;
+        uint users;
+        //false for meshes handed out by modify, they are not found by acquire
+        bool cached;
+    };
+    map<Key, Primitive*> shared;
+    map<Primitive*, Entry> entries;
+
+    static Primitive* create(const Key& k) {
+        return new Primitive(k.primitive, k.uvmap);
+    }
+};
+
+#endif /* geometry_h */
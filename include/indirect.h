@@ -0,0 +1,245 @@
+//
+//  indirect.h
+//  BasicOpenGL
+//
+
+#ifndef indirect_h
+#define indirect_h
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <glm/glm.hpp>
+
+#include <arena.h>
+#include <mesh.h>
+
+#include <cstddef>
+#include <map>
+#include <vector>
+
+using namespace std;
+
+//GL 4.3 names glad, generated for 3.3, does not declare
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+typedef void (APIENTRYP MultiDrawElementsIndirectProc)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride);
+
+//vertex attribute that carries the index of a draw's DrawData, see IndirectRenderer
+const unsigned int DRAW_ID_ATTRIBUTE = 5;
+//shader storage binding of the DrawData array, must match default_obj_shader_indirect.vs
+const unsigned int DRAW_BLOCK_BINDING = 0;
+
+//what glMultiDrawElementsIndirect reads for every draw
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;
+};
+
+//std430 image of DrawData in default_obj_shader_indirect.vs
+struct DrawData {
+    glm::mat4 model;
+    //positions of quantized meshes decode to offset + q * scale, w of position_offset is 1 for them
+    glm::vec4 position_offset;
+    glm::vec4 position_scale;
+    GLuint material;
+    GLuint flat;
+    GLuint pad[2];
+};
+static_assert(sizeof(DrawData) == 112, "DrawData must follow the std430 layout of DrawData");
+
+//Draws meshes of the geometry arena with a few glMultiDrawElementsIndirect calls (GL 4.3): one for
+//every arena pool, index type and primitive mode in use, whatever the number of meshes. The model
+//matrix, material and vertex decoding of every draw are in a shader storage buffer. gl_DrawID needs
+//GL 4.6, so every command draws one instance with baseInstance set to its draw's index, and an
+//instanced attribute over the buffer 0, 1, 2, ... hands the index to the shader.
+//Like InstanceBatch, the renderer keeps its GL objects until release() is called.
+class IndirectRenderer {
+    typedef unsigned int uint;
+public:
+    //draws queued since clear and the triangles they cover
+    uint draws, triangles;
+
+    IndirectRenderer() : draws(0), triangles(0), command_count(0), multiDraw(NULL), command_buffer(0), data_buffer(0), id_buffer(0), id_capacity(0), changed_first(0), changed_end(0) {}
+
+    //fetch the GL 4.3 entry point with loader, false if the context is older and the renderer cannot draw
+    bool load(GLADloadproc loader) {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major < 4 || (major == 4 && minor < 3)) { return false; }
+        multiDraw = (MultiDrawElementsIndirectProc)loader("glMultiDrawElementsIndirect");
+        return multiDraw != NULL;
+    }
+    bool available() const {
+        return multiDraw != NULL;
+    }
+    //draw commands queued, one for every draw range of every draw
+    uint commands() const {
+        return command_count;
+    }
+    void clear() {
+        groups.clear();
+        data.clear();
+        draws = triangles = command_count = 0;
+        changed_first = changed_end = 0;
+    }
+    //queue level of mesh, which has to live in an arena, with its model matrix and material slot. Returns
+    //the index of the draw, see setModel
+    uint add(const Mesh& mesh, uint level, const glm::mat4& model, uint material) {
+        const ArenaAllocation* a = mesh.arenaAllocation();
+        bool quantized = mesh.format & VERTEX_QUANTIZED;
+        DrawData d;
+        d.model = model;
+        d.position_offset = glm::vec4(mesh.position_offset, quantized ? 1.0f : 0.0f);
+        d.position_scale = glm::vec4(mesh.position_scale, 0.0f);
+        d.material = material;
+        d.flat = mesh.flat;
+        d.pad[0] = d.pad[1] = 0;
+        uint id = data.size();
+        data.push_back(d);
+        const vector<DrawRange>& drawn = level ? mesh.lods[level - 1].ranges : mesh.ranges;
+        GLint base = a->first_vertex + (level ? mesh.lods[level - 1].base_vertex : 0);
+        //arena index ranges are aligned to 4 bytes, whole indices of every type
+        uint first = a->index_offset / Mesh::indexSize(mesh.index_type);
+        for (uint i = 0; i < drawn.size(); i++) {
+            GroupKey key = {a->pool, mesh.index_type, drawn[i].mode};
+            DrawElementsIndirectCommand command = {drawn[i].count, 1, first + drawn[i].first, base, id};
+            groups[key].push_back(command);
+        }
+        command_count += drawn.size();
+        draws++;
+        triangles += mesh.triangles(level);
+        return id;
+    }
+    //give draw a new model matrix, sent by uploadChanged. The commands stay as they are
+    void setModel(uint draw, const glm::mat4& model) {
+        data[draw].model = model;
+        changed_first = changed_first < changed_end ? min(changed_first, draw) : draw;
+        changed_end = max(changed_end, draw + 1);
+    }
+    //send the draw data from the first to the last draw changed since the last upload, in place
+    void uploadChanged() {
+        if (changed_first >= changed_end) { return; }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, data_buffer);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, changed_first * sizeof(DrawData), (changed_end - changed_first) * sizeof(DrawData), &data[changed_first]);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        changed_first = changed_end = 0;
+    }
+    //send the queued commands and draw data to their buffers
+    void upload() {
+        if (!command_buffer) {
+            glGenBuffers(1, &command_buffer);
+            glGenBuffers(1, &data_buffer);
+            glGenBuffers(1, &id_buffer);
+        }
+        vector<DrawElementsIndirectCommand> commands;
+        for (auto it = groups.begin(); it != groups.end(); it++) {
+            commands.insert(commands.end(), it->second.begin(), it->second.end());
+        }
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.empty() ? NULL : &commands[0], GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, data_buffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, data.size() * sizeof(DrawData), data.empty() ? NULL : &data[0], GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+        changed_first = changed_end = 0;
+        //the draw ids only grow, the vertex arrays keep pointing at the buffer when its storage is replaced
+        if (data.size() > id_capacity) {
+            id_capacity = max<size_t>(data.size(), 2 * id_capacity);
+            vector<GLuint> ids(id_capacity);
+            for (uint i = 0; i < ids.size(); i++) { ids[i] = i; }
+            glBindBuffer(GL_ARRAY_BUFFER, id_buffer);
+            glBufferData(GL_ARRAY_BUFFER, ids.size() * sizeof(GLuint), &ids[0], GL_STATIC_DRAW);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+        }
+    }
+    //draw what was uploaded with the indirect shader in use, returns the multi-draw calls issued
+    uint Draw() {
+        if (groups.empty()) { return 0; }
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_BLOCK_BINDING, data_buffer);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command_buffer);
+        size_t first = 0;
+        uint calls = 0;
+        for (auto it = groups.begin(); it != groups.end(); it++) {
+            const GroupKey& key = it->first;
+            glBindVertexArray(vertexArray(key.pool));
+            //list indices of byte and short meshes may equal the restart index, see Mesh::drawElements
+            bool restart = key.mode == GL_TRIANGLE_STRIP;
+            if (restart) {
+                glEnable(GL_PRIMITIVE_RESTART);
+                glPrimitiveRestartIndex(key.type == GL_UNSIGNED_BYTE ? 0xFF : (key.type == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF));
+            }
+            multiDraw(key.mode, key.type, (const void*)(first * sizeof(DrawElementsIndirectCommand)), it->second.size(), 0);
+            if (restart) { glDisable(GL_PRIMITIVE_RESTART); }
+            first += it->second.size();
+            calls++;
+        }
+        glBindVertexArray(0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        return calls;
+    }
+    //free the buffers and vertex arrays. Vertex arrays refer to arena pools, release after the arena
+    //deleted pools (GeometryArena::trim or clear)
+    void release() {
+        for (auto it = arrays.begin(); it != arrays.end(); it++) {
+            glDeleteVertexArrays(1, &it->second);
+        }
+        arrays.clear();
+        if (command_buffer) {
+            glDeleteBuffers(1, &command_buffer);
+            glDeleteBuffers(1, &data_buffer);
+            glDeleteBuffers(1, &id_buffer);
+        }
+        command_buffer = data_buffer = id_buffer = 0;
+        id_capacity = 0;
+        clear();
+    }
+
+private:
+    struct GroupKey {
+        ArenaPool* pool;
+        GLenum type, mode;
+        bool operator<(const GroupKey& o) const {
+            if (pool != o.pool) { return pool < o.pool; }
+            if (type != o.type) { return type < o.type; }
+            return mode < o.mode;
+        }
+    };
+    uint command_count;
+    MultiDrawElementsIndirectProc multiDraw;
+    GLuint command_buffer, data_buffer, id_buffer;
+    size_t id_capacity;
+    //draws [changed_first, changed_end) hold changes the data buffer does not have yet
+    uint changed_first, changed_end;
+    //commands of every multi-draw call, uploaded one group after the other
+    map<GroupKey, vector<DrawElementsIndirectCommand> > groups;
+    vector<DrawData> data;
+    //the pool's buffers and format plus the draw id attribute, per pool
+    map<ArenaPool*, GLuint> arrays;
+
+    GLuint vertexArray(ArenaPool* pool) {
+        auto found = arrays.find(pool);
+        if (found != arrays.end()) { return found->second; }
+        GLuint vao;
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, pool->vbo);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->ebo);
+        setupVertexAttributes(pool->format);
+        glBindBuffer(GL_ARRAY_BUFFER, id_buffer);
+        glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+        glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        arrays[pool] = vao;
+        return vao;
+    }
+};
+
+#endif /* indirect_h */
@@ -0,0 +1,145 @@
+//
+//  instancing.h
+//  BasicOpenGL
+//
+
+#ifndef instancing_h
+#define instancing_h
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <glm/glm.hpp>
+#include <mesh.h>
+#include <shader.h>
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+//first attribute location used by the per instance data, must match default_obj_shader_instanced.vs
+const unsigned int INSTANCE_ATTRIBUTE = 5;
+
+//per instance data as laid out in the instance buffer
+struct InstanceData {
+    glm::mat4 model;
+    //slot of the instance's material in the MaterialBlock uniform block
+    GLuint material;
+};
+
+//Many copies of one mesh drawn with a single glDrawElementsInstanced.
+//The batch owns a vertex array over the mesh's buffers plus an instance buffer, batches are not
+//freed by their destructor (they are copied around in vectors), call release() when done with one.
+class InstanceBatch {
+    typedef unsigned int uint;
+public:
+    Mesh* mesh;
+    vector<InstanceData> instances;
+    //where the data of instances[i] comes from, positions in Scene::objects
+    vector<uint> objects;
+    //instances drawn at level of detail l are [level_first[l], level_first[l + 1]), empty while they are
+    //all drawn at full detail
+    vector<uint> level_first;
+
+    InstanceBatch() : mesh(NULL), VAO(0), instanceVBO(0), capacity(0), changed_first(0), changed_end(0) {}
+
+    //draw instances of m from now on, rebuilds the vertex array if the mesh changed
+    void setMesh(Mesh* m) {
+        if (m == mesh) { return; }
+        release();
+        mesh = m;
+        glGenBuffers(1, &instanceVBO);
+        VAO = mesh->createVertexArray();
+        for (uint i = 0; i < 5; i++) {
+            glEnableVertexAttribArray(INSTANCE_ATTRIBUTE + i);
+            glVertexAttribDivisor(INSTANCE_ATTRIBUTE + i, 1);
+        }
+        pointInstances(0);
+        glBindVertexArray(0);
+    }
+    //send instances to the instance buffer, it only grows, otherwise the old storage is orphaned
+    void upload() {
+        GLsizeiptr size = instances.size() * sizeof(InstanceData);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        if (size > capacity) {
+            capacity = size;
+        }
+        glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.empty() ? NULL : &instances[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        changed_first = changed_end = 0;
+    }
+    //give instance i a new model matrix, sent by uploadChanged
+    void setModel(uint i, const glm::mat4& model) {
+        instances[i].model = model;
+        changed_first = changed_first < changed_end ? min(changed_first, i) : i;
+        changed_end = max(changed_end, i + 1);
+    }
+    //send the instances from the first to the last one changed since the last upload, in place
+    void uploadChanged() {
+        if (changed_first >= changed_end) { return; }
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, changed_first * sizeof(InstanceData), (changed_end - changed_first) * sizeof(InstanceData), &instances[changed_first]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        changed_first = changed_end = 0;
+    }
+    //instances are untextured, only the vertex array needs binding. Returns the draw calls issued, one per
+    //level of detail in use
+    uint Draw() {
+        glBindVertexArray(VAO);
+        uint draws = 0;
+        if (level_first.empty()) {
+            mesh->drawElements(instances.size());
+            draws++;
+        }
+        //without a base instance in GL 3.3 every level gets the instance attributes pointed at its instances
+        for (uint l = 0; l + 1 < level_first.size(); l++) {
+            uint count = level_first[l + 1] - level_first[l];
+            if (!count) { continue; }
+            pointInstances(level_first[l]);
+            mesh->drawElements(count, l);
+            draws++;
+        }
+        glBindVertexArray(0);
+        return draws;
+    }
+    //triangles the last Draw submitted
+    uint triangles() const {
+        if (level_first.empty()) { return instances.size() * mesh->triangles(); }
+        uint total = 0;
+        for (uint l = 0; l + 1 < level_first.size(); l++) {
+            total += (level_first[l + 1] - level_first[l]) * mesh->triangles(l);
+        }
+        return total;
+    }
+    void release() {
+        if (VAO) {
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteBuffers(1, &instanceVBO);
+        }
+        VAO = instanceVBO = 0;
+        capacity = 0;
+        changed_first = changed_end = 0;
+        mesh = NULL;
+        level_first.clear();
+    }
+
+private:
+    uint VAO, instanceVBO;
+    GLsizeiptr capacity;
+    //instances [changed_first, changed_end) hold changes the instance buffer does not have yet
+    uint changed_first, changed_end;
+
+    //source the instance attributes of the bound vertex array from instance first on
+    void pointInstances(uint first) {
+        size_t base = first * sizeof(InstanceData);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        //a mat4 attribute takes four consecutive locations, one per column
+        for (uint i = 0; i < 4; i++) {
+            glVertexAttribPointer(INSTANCE_ATTRIBUTE + i, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, model) + i * sizeof(glm::vec4)));
+        }
+        glVertexAttribIPointer(INSTANCE_ATTRIBUTE + 4, 1, GL_UNSIGNED_INT, sizeof(InstanceData), (void*)(base + offsetof(InstanceData, material)));
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+
+#endif /* instancing_h */
@@ -7,6 +7,9 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <shader.h>
+#include <arena.h>
+#include <meshopt.h>
+#include <vertexformat.h>
 
 #include <string>
 #include <fstream>
@@ -31,113 +34,709 @@ struct Vertex {
 struct Texture {
     unsigned int id;
     string type;
+    //texture unit of the sampler this texture is bound to, see samplerUnit
+    int unit;
     //string path;
 };
 
+//a texture bind resolved ahead of drawing
+struct TextureBinding {
+    unsigned int unit;
+    unsigned int id;
+};
+
+//texture bound to every sampler unit and the vertex array bound, lets consecutive draws skip binds that
+//are already in place. Draws through a cache leave their vertex array bound for the next one
+struct TextureCache {
+    static const unsigned int UNITS = SAMPLER_TYPE_COUNT * SAMPLERS_PER_TYPE;
+    unsigned int bound[UNITS];
+    unsigned int binds;
+    unsigned int skipped;
+    unsigned int vertex_array;
+    unsigned int array_binds;
+    unsigned int arrays_skipped;
+    // forget what is bound, call it whenever textures or vertex arrays may have been bound behind the
+    // cache's back
+    void reset()
+    {
+        for(unsigned int i = 0; i < UNITS; i++)
+            bound[i] = ~0u;
+        vertex_array = ~0u;
+        binds = skipped = array_binds = arrays_skipped = 0;
+    }
+};
+
+// a regular grid of quads within a mesh's triangles: nz rows of nxy vertices from vbegin on, triangulated
+// into indices[first, first + count). The grid closes on itself across rows or columns when wrapped
+struct QuadGrid {
+    unsigned int first, count;
+    unsigned int vbegin, nxy, nz;
+    bool wrapxy, wrapz;
+};
+
+// part of the uploaded index buffer drawn with one primitive mode
+struct DrawRange {
+    GLenum mode;
+    unsigned int first, count;
+};
+
+// a coarser version of a mesh, uploaded into the mesh's buffers behind the mesh's own vertices and indices
+struct MeshLevel {
+    vector<Vertex> vertices;
+    vector<unsigned int> indices;
+    vector<QuadGrid> grids;
+    // how far the level's surface may lie from the full detail one, in model space
+    float error;
+    // first vertex of the level in the vertex buffer, its indices count from there
+    unsigned int base_vertex;
+    vector<DrawRange> ranges;
+    // old number of every uploaded vertex of the level when the upload was optimized, empty otherwise
+    vector<unsigned int> order;
+};
+
 class Mesh {
 public:
     /*  Mesh Data  */
     vector<Vertex> vertices;
     vector<unsigned int> indices;
     vector<Texture> textures;
+    vector<TextureBinding> bindings;
+    // hash of bindings, meshes with the same textures in the same units share it
+    unsigned int texture_set;
+    // attributes uploaded and how they are stored, see vertexformat.h
+    unsigned int format;
+    // quantized positions decode to position_offset + q * position_scale, q in [0, 1]^3
+    glm::vec3 position_offset;
+    glm::vec3 position_scale;
+    // shade every triangle with its face normal, computed in the fragment shader from the derivatives of
+    // the fragment position. Gives faceted meshes without a vertex per triangle corner
+    bool flat;
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT, the smaller type that can address every vertex. indices
+    // always holds unsigned ints, they are narrowed when uploaded
+    GLenum index_type;
+    // upload the triangles and vertices reordered for the vertex cache, overdraw and vertex fetch, see
+    // meshopt.h. vertices and indices keep their order, only the buffers are reordered
+    bool optimize;
+    // cache behaviour before and after the last optimized upload
+    MeshOptimization optimization;
+    // upload the quad grids as triangle strips, a row each, split by primitive restart indices. The
+    // other triangles stay a list. Strip meshes are not reordered by optimize
+    bool strips;
+    // arena the vertex and index buffers are suballocated from, see arena.h. NULL gives the mesh a vertex
+    // array and buffers of its own. Changing it takes a release first
+    GeometryArena *arena;
+    // the vertices are edited often: the vertex buffer is GL_DYNAMIC_DRAW, updateVertices orphans it when
+    // it rewrites all of it and writes parts through an invalidated mapped range
+    bool dynamic;
+    vector<QuadGrid> grids;
+    // what Draw issues, set up with the index buffer
+    vector<DrawRange> ranges;
+    // coarser levels of detail, finest first. Draw picks one by number, level 0 is the mesh itself
+    vector<MeshLevel> lods;
+    // bounding sphere of the vertices, in model space
+    glm::vec3 center;
+    float radius;
+    // axis aligned bounding box of the vertices of every level, in model space
+    glm::vec3 box_min, box_max;
     unsigned int VAO;
     
     /*  Functions  */
     // constructor
-    Mesh() {}
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh() : texture_set(0), format(VERTEX_FULL), flat(false), index_type(GL_UNSIGNED_INT), optimize(false), strips(false), arena(&GeometryArena::shared()), dynamic(false), radius(0), box_min(0.0f), box_max(0.0f), VAO(0), VBO(0), EBO(0), index_count(0), vertex_bytes(0), allocation(NULL) {}
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures, bool optimize = false) : texture_set(0), format(VERTEX_FULL), flat(false), index_type(GL_UNSIGNED_INT), optimize(optimize), strips(false), arena(&GeometryArena::shared()), dynamic(false), radius(0), box_min(0.0f), box_max(0.0f), VAO(0), VBO(0), EBO(0), index_count(0), vertex_bytes(0), allocation(NULL)
     {
         this->vertices = vertices;
         this->indices = indices;
         this->textures = textures;
+        for(unsigned int i = 0; i < textures.size(); i++)
+            bindTexture(textures[i]);
         
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
         setupMesh();
     }
     
-    // render the mesh
-    void Draw(Shader shader)
+    // attach a texture, it becomes the next sampler of its type (texture_diffuse1, texture_diffuse2, ...)
+    void addTexture(unsigned int id, const string &type)
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int emissionNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
+        unsigned int n = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
+            if(textures[i].type == type)
+                n++;
+        Texture texture;
+        texture.id = id;
+        texture.type = type;
+        texture.unit = samplerUnit(type, n);
+        textures.push_back(texture);
+        bindTexture(texture);
+    }
+    
+    // create another vertex array over this mesh's buffers, for instanced drawing.
+    // It is left bound so the caller can add its per instance attributes.
+    unsigned int createVertexArray()
+    {
+        unsigned int vao;
+        glGenVertexArrays(1, &vao);
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        setupAttributes();
+        return vao;
+    }
+    
+    // bytes of vertex and index data uploaded for the mesh, all levels included
+    size_t gpuBytes() const
+    {
+        size_t uploaded = vertices.size();
+        for(unsigned int i = 0; i < lods.size(); i++)
+            uploaded += lods[i].vertices.size();
+        return uploaded * VertexLayout(format).stride + index_count * indexSize(index_type);
+    }
+    
+    // indices uploaded for all levels, restart indices included
+    unsigned int indexCount() const
+    {
+        return index_count;
+    }
+    
+    // levels of detail Draw can pick from
+    unsigned int levels() const
+    {
+        return lods.size() + 1;
+    }
+    // triangles drawn at level
+    unsigned int triangles(unsigned int level = 0) const
+    {
+        return (level ? lods[level - 1].indices.size() : indices.size()) / 3;
+    }
+    
+    // smallest index type that can address vertex_count vertices. Small meshes still get 16 bit indices,
+    // many GPUs fetch GL_UNSIGNED_BYTE indices by widening them on every draw
+    static GLenum indexType(size_t vertex_count)
+    {
+        if(vertex_count <= 0x10000)
+            return GL_UNSIGNED_SHORT;
+        return GL_UNSIGNED_INT;
+    }
+    // bytes of one index of type
+    static unsigned int indexSize(GLenum type)
+    {
+        return type == GL_UNSIGNED_BYTE ? 1 : (type == GL_UNSIGNED_SHORT ? 2 : 4);
+    }
+    
+    // one line describing the index buffer: its type, size and what it saves over 32 bit indices
+    string indexReport() const
+    {
+        const char *name = index_type == GL_UNSIGNED_BYTE ? "GL_UNSIGNED_BYTE" : (index_type == GL_UNSIGNED_SHORT ? "GL_UNSIGNED_SHORT" : "GL_UNSIGNED_INT");
+        size_t bytes = index_count * indexSize(index_type), listed = indices.size();
+        for(unsigned int i = 0; i < lods.size(); i++)
+            listed += lods[i].indices.size();
+        stringstream report;
+        report << vertices.size() << " vertices, " << index_count << " indices as " << name << (ranges.size() > 1 || (!ranges.empty() && ranges[0].mode == GL_TRIANGLE_STRIP) ? " (strips)" : "");
+        if(!lods.empty())
+            report << " in " << levels() << " levels";
+        report << ": " << bytes << " bytes, " << listed * sizeof(unsigned int) - bytes << " saved";
+        return report.str();
+    }
+    
+    // one line comparing the vertex cache behaviour of the uploaded order with the generated one
+    string optimizationReport() const
+    {
+        stringstream report;
+        if(!optimize)
+            report << "not optimized";
+        else
+            report << "ACMR " << optimization.before.acmr << " -> " << optimization.after.acmr << ", ATVR " << optimization.before.atvr
+                   << " -> " << optimization.after.atvr << ", " << optimization.clusters << " overdraw clusters";
+        return report.str();
+    }
+    
+    // upload the vertices again in another format, into the buffers the mesh already has
+    void setFormat(unsigned int f)
+    {
+        format = f;
+        setupMesh();
+    }
+    
+    // send vertices [first, first + count) of the mesh itself (level 0) again after their attributes were
+    // edited, into the buffers the mesh already has. Vertices are interleaved, so the range carries every
+    // attribute of the vertices it covers. Optimized uploads scatter the vertices and quantized positions
+    // that move the bounds change every vertex, those send the whole mesh
+    void updateVertices(unsigned int first, unsigned int count)
+    {
+        if(!VAO)
+        {
+            setupMesh();
+            return;
+        }
+        glm::vec3 offset = position_offset, scale = position_scale;
+        computeBounds();
+        if((format & VERTEX_QUANTIZED) && (offset != position_offset || scale != position_scale))
+        {
+            updateVertices();
+            return;
+        }
+        if(!vertex_order.empty())
+        {
+            first = 0;
+            count = vertices.size();
+        }
+        first = min(first, (unsigned int)vertices.size());
+        count = min(count, (unsigned int)vertices.size() - first);
+        if(!count)
+            return;
+        vector<unsigned char> packed;
+        packVertices(vertices, vertex_order, packed, first, count);
+        writeVertices(first * VertexLayout(format).stride, packed);
+    }
+    // send the vertices of every level again, see updateVertices(first, count). Levels whose vertex
+    // count changed need new buffers, setupMesh is run for them instead
+    void updateVertices()
+    {
+        if(!VAO)
+        {
+            setupMesh();
+            return;
+        }
+        computeBounds();
+        vector<unsigned char> packed;
+        packVertices(vertices, vertex_order, packed);
+        for(unsigned int i = 0; i < lods.size(); i++)
+            packVertices(lods[i].vertices, lods[i].order, packed);
+        if(packed.size() != vertex_bytes)
+            setupMesh();
+        else if(!packed.empty())
+            writeVertices(0, packed);
+    }
+    
+    // free the vertex array and buffers, the cpu side data is kept so setupMesh can upload it again
+    void release()
+    {
+        if(allocation)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to stream
-            else if(name == "texture_emission")
-                number = std::to_string(emissionNr++); // transfer unsigned int to stream
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to stream
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to stream
-            
-            // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            arena->free(allocation);
+            allocation = NULL;
+        }
+        else if(VAO)
+        {
+            glDeleteVertexArrays(1, &VAO);
+            glDeleteBuffers(1, &VBO);
+            glDeleteBuffers(1, &EBO);
+        }
+        VAO = VBO = EBO = 0;
+        vertex_bytes = 0;
+    }
+    
+    // render level of the mesh, binds already recorded in cache (if given) are skipped
+    void Draw(const Shader &/*shader*/, TextureCache *cache = NULL, unsigned int level = 0)
+    {
+        // bind appropriate textures, the shader's samplers already point at these units
+        bool switched = false;
+        for(unsigned int i = 0; i < bindings.size(); i++)
+        {
+            if(cache && cache->bound[bindings[i].unit] == bindings[i].id)
+            {
+                cache->skipped++;
+                continue;
+            }
+            glActiveTexture(GL_TEXTURE0 + bindings[i].unit);
+            glBindTexture(GL_TEXTURE_2D, bindings[i].id);
+            switched = true;
+            if(cache)
+            {
+                cache->bound[bindings[i].unit] = bindings[i].id;
+                cache->binds++;
+            }
         }
         
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
+        // draw mesh, meshes sharing an arena pool share its vertex array
+        if(!cache)
+            glBindVertexArray(VAO);
+        else if(cache->vertex_array != VAO)
+        {
+            glBindVertexArray(VAO);
+            cache->vertex_array = VAO;
+            cache->array_binds++;
+        }
+        else
+            cache->arrays_skipped++;
+        drawElements(1, level);
+        if(!cache)
+            glBindVertexArray(0);
         
         // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        if(switched)
+            glActiveTexture(GL_TEXTURE0);
+    }
+    
+    // where the mesh's data starts in its buffers, 0 unless it lives in an arena
+    unsigned int firstVertex() const
+    {
+        return allocation ? allocation->first_vertex : 0;
+    }
+    size_t firstIndexByte() const
+    {
+        return allocation ? allocation->index_offset : 0;
+    }
+    // the mesh's place in its arena, NULL while it has buffers of its own or is not uploaded
+    const ArenaAllocation *arenaAllocation() const
+    {
+        return allocation;
+    }
+
+    // issue the draw ranges of a level of the mesh, with its vertex array bound. More than one instance
+    // draws instanced
+    void drawElements(unsigned int instances = 1, unsigned int level = 0) const
+    {
+        const vector<DrawRange> &drawn = level ? lods[level - 1].ranges : ranges;
+        GLint base = firstVertex() + (level ? lods[level - 1].base_vertex : 0);
+        for(unsigned int i = 0; i < drawn.size(); i++)
+        {
+            const DrawRange &range = drawn[i];
+            const void *offset = (const void*)(firstIndexByte() + range.first * indexSize(index_type));
+            bool restart = range.mode == GL_TRIANGLE_STRIP;
+            if(restart)
+            {
+                // the largest value of the index type, unsigned bytes and shorts restart too
+                glEnable(GL_PRIMITIVE_RESTART);
+                glPrimitiveRestartIndex(index_type == GL_UNSIGNED_BYTE ? 0xFF : (index_type == GL_UNSIGNED_SHORT ? 0xFFFF : 0xFFFFFFFF));
+            }
+            if(instances == 1)
+                glDrawElementsBaseVertex(range.mode, range.count, index_type, offset, base);
+            else
+                glDrawElementsInstancedBaseVertex(range.mode, range.count, index_type, offset, instances, base);
+            // list indices of byte and short meshes may equal the restart index
+            if(restart)
+                glDisable(GL_PRIMITIVE_RESTART);
+        }
     }
     
 protected:
     /*  Render data  */
     unsigned int VBO, EBO;
+    unsigned int index_count;
+    // size of the mesh's vertex data, the whole vertex buffer unless it lives in an arena
+    size_t vertex_bytes;
+    // the mesh's place in arena, NULL while it is not uploaded to one
+    ArenaAllocation *allocation;
+    // old number of every uploaded vertex when the upload was optimized, empty otherwise
+    vector<unsigned int> vertex_order;
+    
+    // record where a texture is bound when the mesh is drawn
+    void bindTexture(const Texture &texture)
+    {
+        if(texture.unit < 0)
+        {
+            cerr << "ERROR::MESH::NO_SAMPLER_FOR_TEXTURE of type: " << texture.type << endl;
+            return;
+        }
+        TextureBinding binding = {(unsigned int)texture.unit, texture.id};
+        bindings.push_back(binding);
+        texture_set = (texture_set ^ (binding.unit * 31 + binding.id)) * 16777619u;
+    }
     
     /*  Functions    */
-    // initializes all the buffer objects/arrays
+    // initializes all the buffer objects/arrays, or the mesh's range of its arena. A mesh uploaded before
+    // keeps its vertex array and buffers, only their storage is replaced, so vertex arrays of instance
+    // batches over them stay valid
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
+        computeBounds();
+        // every level's indices count from the level's first vertex, so the index type only has to address
+        // the largest level. Strips keep the largest index of the type free for restarts
+        size_t largest = vertices.size();
+        bool restarts = strips && !grids.empty();
+        for(unsigned int i = 0; i < lods.size(); i++)
+        {
+            largest = max(largest, lods[i].vertices.size());
+            restarts = restarts || (strips && !lods[i].grids.empty());
+        }
+        index_type = indexType(largest + (restarts ? 1 : 0));
+        // the indices of all levels, one after the other
+        vector<unsigned int> upload;
+        ranges = uploadLevel(vertices, indices, grids, upload, vertex_order, &optimization);
+        unsigned int base = vertices.size();
+        for(unsigned int i = 0; i < lods.size(); i++)
+        {
+            lods[i].base_vertex = base;
+            lods[i].ranges = uploadLevel(lods[i].vertices, lods[i].indices, lods[i].grids, upload, lods[i].order, NULL);
+            base += lods[i].vertices.size();
+        }
         
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        const void *vertex_data;
+        vector<unsigned char> packed;
+        if(format == VERTEX_FULL && vertex_order.empty() && lods.empty())
+        {
+            vertex_bytes = vertices.size() * sizeof(Vertex);
+            vertex_data = vertices.empty() ? NULL : &vertices[0];
+        }
+        else
+        {
+            // other formats, reordered vertices and levels of detail are packed into a scratch copy first
+            packVertices(vertices, vertex_order, packed);
+            for(unsigned int i = 0; i < lods.size(); i++)
+                packVertices(lods[i].vertices, lods[i].order, packed);
+            vertex_bytes = packed.size();
+            vertex_data = packed.empty() ? NULL : &packed[0];
+        }
+        index_count = upload.size();
+        const void *index_data = upload.empty() ? NULL : &upload[0];
+        vector<unsigned char> narrowed;
+        if(index_type != GL_UNSIGNED_INT)
+        {
+            packIndices(upload, narrowed);
+            index_data = narrowed.empty() ? NULL : &narrowed[0];
+        }
+        size_t index_bytes = index_count * indexSize(index_type);
         
+        if(arena)
+        {
+            uploadToArena(vertex_data, index_data, index_bytes);
+            return;
+        }
+        // create buffers/arrays
+        if(!VAO)
+        {
+            glGenVertexArrays(1, &VAO);
+            glGenBuffers(1, &VBO);
+            glGenBuffers(1, &EBO);
+        }
+        glBindVertexArray(VAO);
+        // load data into vertex buffers
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertex_bytes, vertex_data, dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW);
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-        
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_bytes, index_data, GL_STATIC_DRAW);
         
+        setupAttributes();
         glBindVertexArray(0);
     }
+    
+    // write the packed vertices and indices into the mesh's range of its arena, taking a new range when the
+    // sizes or the format changed. The pool's buffers are written through the copy targets, binding the
+    // element array buffer would change whatever vertex array is bound
+    void uploadToArena(const void *vertex_data, const void *index_data, size_t index_bytes)
+    {
+        unsigned int stride = VertexLayout(format).stride, count = vertex_bytes / stride;
+        if(allocation && (allocation->pool->format != format || allocation->vertex_count != count || allocation->index_bytes != index_bytes))
+        {
+            arena->free(allocation);
+            allocation = NULL;
+        }
+        if(!allocation)
+            allocation = arena->allocate(format, count, index_bytes);
+        VAO = allocation->pool->vao;
+        VBO = allocation->pool->vbo;
+        EBO = allocation->pool->ebo;
+        if(vertex_data)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, VBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, (size_t)allocation->first_vertex * stride, vertex_bytes, vertex_data);
+        }
+        if(index_data)
+        {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, EBO);
+            glBufferSubData(GL_COPY_WRITE_BUFFER, allocation->index_offset, index_bytes, index_data);
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    
+    // append the indices of one level to upload, as strips, optimized or as they are, and return the ranges
+    // that draw them. order gets the level's vertex order if it was optimized, stats what optimizing gained
+    vector<DrawRange> uploadLevel(const vector<Vertex> &source, const vector<unsigned int> &list, const vector<QuadGrid> &quads, vector<unsigned int> &upload, vector<unsigned int> &order, MeshOptimization *stats)
+    {
+        vector<DrawRange> drawn;
+        unsigned int first = upload.size();
+        order.clear();
+        if(strips && !quads.empty())
+        {
+            buildStrips(list, quads, upload, drawn);
+            return drawn;
+        }
+        if(optimize && !list.empty())
+        {
+            vector<unsigned int> optimized;
+            MeshOptimization result = optimizeMesh(list, source.size(), &source[0].Position, sizeof(Vertex), optimized, order);
+            if(stats)
+                *stats = result;
+            upload.insert(upload.end(), optimized.begin(), optimized.end());
+        }
+        else
+            upload.insert(upload.end(), list.begin(), list.end());
+        DrawRange all = {GL_TRIANGLES, first, (unsigned int)upload.size() - first};
+        drawn.push_back(all);
+        return drawn;
+    }
+    
+    // append the triangles outside the quads as a list, then the quads as strips, and add the ranges that
+    // draw them
+    static void buildStrips(const vector<unsigned int> &list, const vector<QuadGrid> &quads, vector<unsigned int> &out, vector<DrawRange> &drawn)
+    {
+        const unsigned int restart = ~0u;
+        unsigned int first = out.size(), next = 0;
+        for(unsigned int g = 0; g < quads.size(); g++)
+        {
+            out.insert(out.end(), list.begin() + next, list.begin() + quads[g].first);
+            next = quads[g].first + quads[g].count;
+        }
+        out.insert(out.end(), list.begin() + next, list.end());
+        unsigned int strip = out.size();
+        for(unsigned int g = 0; g < quads.size(); g++)
+        {
+            const QuadGrid &grid = quads[g];
+            unsigned int rows = grid.wrapz ? grid.nz : grid.nz - 1, cols = grid.wrapxy ? grid.nxy : grid.nxy - 1;
+            for(unsigned int i = 0; i < rows; i++)
+            {
+                if(out.size() > strip)
+                    out.push_back(restart);
+                // zigzag between row i and the next one. Quads are cut along the opposite diagonal to the
+                // triangle list's, with the same winding
+                unsigned int row = grid.vbegin + grid.nxy * i, above = grid.vbegin + grid.nxy * ((i + 1) % grid.nz);
+                for(unsigned int j = 0; j <= cols; j++)
+                {
+                    out.push_back(row + j % grid.nxy);
+                    out.push_back(above + j % grid.nxy);
+                }
+            }
+        }
+        if(strip > first)
+        {
+            DrawRange triangles = {GL_TRIANGLES, first, strip - first};
+            drawn.push_back(triangles);
+        }
+        if(out.size() > strip)
+        {
+            DrawRange strips = {GL_TRIANGLE_STRIP, strip, (unsigned int)out.size() - strip};
+            drawn.push_back(strips);
+        }
+    }
+    
+    // narrow source to 16 bit index_type into packed
+    void packIndices(const vector<unsigned int> &source, vector<unsigned char> &packed) const
+    {
+        packed.resize(source.size() * indexSize(index_type));
+        for(unsigned int i = 0; i < source.size(); i++)
+        {
+            uint16_t index = (uint16_t)source[i];
+            memcpy(&packed[2 * i], &index, sizeof(index));
+        }
+    }
+    
+    // bounding box and sphere of the vertices of every level, quantized positions are stored against the box
+    void computeBounds()
+    {
+        glm::vec3 lo(0.0f), hi(0.0f);
+        bool first = true;
+        for(unsigned int l = 0; l < levels(); l++)
+        {
+            const vector<Vertex> &source = l ? lods[l - 1].vertices : vertices;
+            for(unsigned int i = 0; i < source.size(); i++)
+            {
+                lo = first ? source[i].Position : glm::min(lo, source[i].Position);
+                hi = first ? source[i].Position : glm::max(hi, source[i].Position);
+                first = false;
+            }
+        }
+        center = (lo + hi) * 0.5f;
+        radius = 0;
+        for(unsigned int i = 0; i < vertices.size(); i++)
+            radius = max(radius, glm::length(vertices[i].Position - center));
+        box_min = lo;
+        box_max = hi;
+        position_offset = lo;
+        position_scale = hi - lo;
+    }
+    
+    // interleave the attributes of format of the vertices of source, in order if it is not empty, at the end
+    // of packed, see VertexLayout. Only uploaded vertices [first, first + count) are packed
+    void packVertices(const vector<Vertex> &source, const vector<unsigned int> &order, vector<unsigned char> &packed, unsigned int first = 0, unsigned int count = ~0u) const
+    {
+        VertexLayout layout(format);
+        bool quantized = format & VERTEX_QUANTIZED;
+        size_t start = packed.size();
+        count = min(count, (unsigned int)source.size() - min(first, (unsigned int)source.size()));
+        packed.resize(start + count * layout.stride, 0);
+        for(unsigned int i = 0; i < count; i++)
+        {
+            unsigned char *out = &packed[start + i * layout.stride];
+            const Vertex &v = source[order.empty() ? first + i : order[first + i]];
+            if(format & VERTEX_POSITION)
+            {
+                if(quantized)
+                {
+                    uint16_t q[3];
+                    for(unsigned int k = 0; k < 3; k++)
+                        q[k] = position_scale[k] > 0 ? uint16_t(floor((v.Position[k] - position_offset[k]) / position_scale[k] * 65535.0f + 0.5f)) : 0;
+                    memcpy(out + layout.offset[0], q, sizeof(q));
+                }
+                else
+                    memcpy(out + layout.offset[0], &v.Position, sizeof(glm::vec3));
+            }
+            if(format & VERTEX_NORMAL)
+            {
+                if(quantized)
+                {
+                    int16_t n[2];
+                    octEncode(v.Normal, n);
+                    memcpy(out + layout.offset[1], n, sizeof(n));
+                }
+                else
+                    memcpy(out + layout.offset[1], &v.Normal, sizeof(glm::vec3));
+            }
+            if(format & VERTEX_UV)
+            {
+                if(quantized)
+                {
+                    uint16_t uv[2] = {toHalf(v.TexCoords.x), toHalf(v.TexCoords.y)};
+                    memcpy(out + layout.offset[2], uv, sizeof(uv));
+                }
+                else
+                    memcpy(out + layout.offset[2], &v.TexCoords, sizeof(glm::vec2));
+            }
+            if(format & VERTEX_TANGENTS)
+            {
+                memcpy(out + layout.offset[3], &v.Tangent, sizeof(glm::vec3));
+                memcpy(out + layout.offset[4], &v.Bitangent, sizeof(glm::vec3));
+            }
+        }
+    }
+    
+    // write data over the mesh's vertex data from byte offset on, its size does not change
+    void writeVertices(size_t offset, const vector<unsigned char> &data)
+    {
+        // arena buffers are shared, only ranges of them are written
+        offset += (size_t)firstVertex() * VertexLayout(format).stride;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        if(dynamic && !allocation && offset == 0 && data.size() == vertex_bytes)
+        {
+            // orphan the old storage, the driver hands out new storage instead of waiting for draws that
+            // still read the old one
+            glBufferData(GL_ARRAY_BUFFER, vertex_bytes, NULL, GL_DYNAMIC_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, data.size(), &data[0]);
+        }
+        else if(dynamic)
+        {
+            // the range's old contents are dropped, so mapping does not read them back or wait for them
+            void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, offset, data.size(), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            if(mapped)
+            {
+                memcpy(mapped, &data[0], data.size());
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+            else
+                glBufferSubData(GL_ARRAY_BUFFER, offset, data.size(), &data[0]);
+        }
+        else
+            glBufferSubData(GL_ARRAY_BUFFER, offset, data.size(), &data[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    
+    // set the vertex attribute pointers of the mesh's format for the vertex buffer bound to GL_ARRAY_BUFFER
+    void setupAttributes()
+    {
+        setupVertexAttributes(format);
+    }
 };
 #endif
@@ -0,0 +1,242 @@
+//
+//  meshopt.h
+//  BasicOpenGL
+//
+
+#ifndef meshopt_h
+#define meshopt_h
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+//Index and vertex reordering for the GPU, after Sander, Nehab and Barczak, "Fast Triangle Reordering
+//for Vertex Locality and Reduced Overdraw" (Tipsify). Only the order of triangles and vertices changes,
+//the mesh renders the same.
+
+//entries of the post-transform cache the orders are tuned for and measured with
+const unsigned int VERTEX_CACHE_SIZE = 16;
+//a cluster is cut once its own cache miss ratio is within this factor of the whole mesh's, smaller
+//clusters sort better for overdraw but start with a cold cache more often
+const float OVERDRAW_THRESHOLD = 1.05f;
+
+//vertex transforms of an index order, replayed on a FIFO cache of VERTEX_CACHE_SIZE entries
+struct VertexCacheStats {
+    //average cache miss ratio: vertices transformed per triangle, 3 at worst, about 0.5 for regular grids
+    float acmr;
+    //average transform to vertex ratio: vertices transformed per vertex referenced, 1 at best
+    float atvr;
+};
+
+inline VertexCacheStats simulateVertexCache(const vector<unsigned int>& indices, unsigned int vertex_count, unsigned int cache_size = VERTEX_CACHE_SIZE) {
+    //a vertex is cached while fewer than cache_size misses happened since its own
+    vector<unsigned int> stamp(vertex_count, 0);
+    unsigned int time = cache_size + 1, misses = 0, referenced = 0;
+    for (unsigned int i = 0; i < indices.size(); i++) {
+        unsigned int v = indices[i];
+        if (time - stamp[v] > cache_size) {
+            if (!stamp[v]) { referenced++; }
+            stamp[v] = time++;
+            misses++;
+        }
+    }
+    VertexCacheStats stats = {0.0f, 0.0f};
+    if (indices.size() >= 3) { stats.acmr = float(misses) / (indices.size() / 3); }
+    if (referenced) { stats.atvr = float(misses) / referenced; }
+    return stats;
+}
+
+//Tipsify: emit the triangles around a fanning vertex, then move the fan to the vertex of those
+//triangles that stays in the cache longest. clusters gets the first triangle of every run that starts
+//with a cold fanning vertex, runs between them share no cached vertices.
+inline void tipsify(const vector<unsigned int>& indices, unsigned int vertex_count, vector<unsigned int>& out, vector<unsigned int>& clusters, unsigned int cache_size = VERTEX_CACHE_SIZE) {
+    unsigned int triangles = indices.size() / 3;
+    //triangles around every vertex, and how many of them are still to be emitted
+    vector<unsigned int> live(vertex_count, 0), offset(vertex_count + 1, 0), adjacency(triangles * 3);
+    for (unsigned int i = 0; i < triangles * 3; i++) { live[indices[i]]++; }
+    for (unsigned int v = 0; v < vertex_count; v++) { offset[v + 1] = offset[v] + live[v]; }
+    vector<unsigned int> fill(offset.begin(), offset.end() - 1);
+    for (unsigned int i = 0; i < triangles * 3; i++) { adjacency[fill[indices[i]]++] = i / 3; }
+
+    vector<unsigned int> stamp(vertex_count, 0), dead_ends, candidates;
+    vector<bool> emitted(triangles, false);
+    unsigned int time = cache_size + 1, cursor = 0;
+    out.clear();
+    out.reserve(triangles * 3);
+    clusters.clear();
+    //vertex with triangles left, from the dead end stack while there are any, else in index order
+    auto skipDeadEnd = [&]() -> int {
+        while (!dead_ends.empty()) {
+            unsigned int v = dead_ends.back();
+            dead_ends.pop_back();
+            if (live[v] > 0) { return int(v); }
+        }
+        for (; cursor < vertex_count; cursor++) {
+            if (live[cursor] > 0) { return int(cursor); }
+        }
+        return -1;
+    };
+    int fan = skipDeadEnd();
+    while (fan >= 0) {
+        if (time - stamp[fan] > cache_size) { clusters.push_back(out.size() / 3); }
+        candidates.clear();
+        for (unsigned int a = offset[fan]; a < offset[fan + 1]; a++) {
+            unsigned int t = adjacency[a];
+            if (emitted[t]) { continue; }
+            emitted[t] = true;
+            for (unsigned int k = 0; k < 3; k++) {
+                unsigned int v = indices[3 * t + k];
+                out.push_back(v);
+                dead_ends.push_back(v);
+                candidates.push_back(v);
+                live[v]--;
+                if (time - stamp[v] > cache_size) { stamp[v] = time++; }
+            }
+        }
+        //the candidate still cached after its remaining triangles are emitted that entered the cache
+        //first, candidates that would fall out of the cache on the way score 0
+        int next = -1, best = -1;
+        for (unsigned int i = 0; i < candidates.size(); i++) {
+            unsigned int v = candidates[i];
+            if (!live[v]) { continue; }
+            int priority = 0;
+            if (time - stamp[v] + 2 * live[v] <= cache_size) { priority = int(time - stamp[v]); }
+            if (priority > best) {
+                best = priority;
+                next = int(v);
+            }
+        }
+        fan = next >= 0 ? next : skipDeadEnd();
+    }
+}
+
+//Cut the clusters of a tipsified index order further, each cluster ends as soon as its cache miss
+//ratio, counted from a cold cache, is within threshold of the ratio of the whole order
+inline void splitClusters(const vector<unsigned int>& indices, unsigned int vertex_count, vector<unsigned int>& clusters, float threshold = OVERDRAW_THRESHOLD, unsigned int cache_size = VERTEX_CACHE_SIZE) {
+    unsigned int triangles = indices.size() / 3;
+    float target = simulateVertexCache(indices, vertex_count, cache_size).acmr * threshold;
+    vector<unsigned int> hard(clusters), stamp(vertex_count, 0);
+    hard.push_back(triangles);
+    clusters.clear();
+    unsigned int time = cache_size + 1;
+    for (unsigned int c = 0; c + 1 < hard.size(); c++) {
+        unsigned int misses = 0, start = hard[c];
+        //moving time past every stamp empties the cache
+        time += cache_size + 1;
+        clusters.push_back(start);
+        for (unsigned int t = hard[c]; t < hard[c + 1]; t++) {
+            for (unsigned int k = 0; k < 3; k++) {
+                unsigned int v = indices[3 * t + k];
+                if (time - stamp[v] > cache_size) {
+                    stamp[v] = time++;
+                    misses++;
+                }
+            }
+            if (t + 1 < hard[c + 1] && misses < target * (t + 1 - start)) {
+                time += cache_size + 1;
+                misses = 0;
+                start = t + 1;
+                clusters.push_back(start);
+            }
+        }
+    }
+}
+
+//Sort clusters so the ones facing away from the mesh center, likely in front of the others, draw
+//first and let early depth testing reject what they cover. Positions are read from the float triples
+//at positions + i * stride bytes.
+inline void sortClusters(const vector<unsigned int>& indices, const vector<unsigned int>& clusters, const void* positions, size_t stride, vector<unsigned int>& out) {
+    unsigned int triangles = indices.size() / 3;
+    auto position = [&](unsigned int v) {
+        const float* p = (const float*)((const char*)positions + v * stride);
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+    //area weighted centroid and normal of every cluster, and of the mesh
+    vector<glm::vec3> centroid(clusters.size(), glm::vec3(0.0f)), normal(clusters.size(), glm::vec3(0.0f));
+    vector<float> area(clusters.size(), 0.0f);
+    glm::vec3 center(0.0f);
+    float total = 0.0f;
+    for (unsigned int c = 0; c < clusters.size(); c++) {
+        unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangles;
+        for (unsigned int t = clusters[c]; t < end; t++) {
+            glm::vec3 a = position(indices[3 * t]), b = position(indices[3 * t + 1]), d = position(indices[3 * t + 2]);
+            glm::vec3 n = glm::cross(b - a, d - a);
+            float w = glm::length(n);
+            centroid[c] += (a + b + d) * (w / 3.0f);
+            normal[c] += n;
+            area[c] += w;
+        }
+        center += centroid[c];
+        total += area[c];
+        if (area[c] > 0) { centroid[c] /= area[c]; }
+    }
+    if (total > 0) { center /= total; }
+    vector<pair<float, unsigned int> > order(clusters.size());
+    for (unsigned int c = 0; c < clusters.size(); c++) {
+        float l = glm::length(normal[c]);
+        order[c] = make_pair(l > 0 ? -glm::dot(centroid[c] - center, normal[c] / l) : 0.0f, c);
+    }
+    stable_sort(order.begin(), order.end());
+    out.clear();
+    out.reserve(indices.size());
+    for (unsigned int i = 0; i < order.size(); i++) {
+        unsigned int c = order[i].second;
+        unsigned int end = c + 1 < clusters.size() ? clusters[c + 1] : triangles;
+        out.insert(out.end(), indices.begin() + 3 * clusters[c], indices.begin() + 3 * end);
+    }
+}
+
+//Renumber the vertices in the order the indices first use them, so vertex fetches walk the buffer
+//forward. order[i] is the old number of new vertex i, unreferenced vertices go last.
+inline void fetchOrder(vector<unsigned int>& indices, unsigned int vertex_count, vector<unsigned int>& order) {
+    const unsigned int unused = ~0u;
+    vector<unsigned int> renumber(vertex_count, unused);
+    order.clear();
+    order.reserve(vertex_count);
+    for (unsigned int i = 0; i < indices.size(); i++) {
+        unsigned int& v = renumber[indices[i]];
+        if (v == unused) {
+            v = order.size();
+            order.push_back(indices[i]);
+        }
+        indices[i] = v;
+    }
+    for (unsigned int v = 0; v < vertex_count; v++) {
+        if (renumber[v] == unused) { order.push_back(v); }
+    }
+}
+
+//what optimizeMesh did to a mesh
+struct MeshOptimization {
+    VertexCacheStats before, after;
+    //clusters the triangles were sorted in for overdraw
+    unsigned int clusters;
+};
+
+//Reorder the triangles of indices for the vertex cache, then their clusters for overdraw, then the
+//vertices for fetch locality. A triangle order that caches worse than indices is not used. out gets the new indices, order the new vertex order as in fetchOrder.
+inline MeshOptimization optimizeMesh(const vector<unsigned int>& indices, unsigned int vertex_count, const void* positions, size_t stride, vector<unsigned int>& out, vector<unsigned int>& order) {
+    MeshOptimization result;
+    result.before = simulateVertexCache(indices, vertex_count);
+    vector<unsigned int> tipsified, clusters;
+    tipsify(indices, vertex_count, tipsified, clusters);
+    splitClusters(tipsified, vertex_count, clusters);
+    sortClusters(tipsified, clusters, positions, stride, out);
+    result.after = simulateVertexCache(out, vertex_count);
+    result.clusters = clusters.size();
+    //the overdraw order gives up a little cache efficiency, on meshes that were nearly optimal to begin
+    //with that can make it worse than the original order, which is then kept
+    if (result.after.acmr > result.before.acmr) {
+        out = indices;
+        result.after = result.before;
+        result.clusters = 0;
+    }
+    fetchOrder(out, vertex_count, order);
+    return result;
+}
+
+#endif /* meshopt_h */
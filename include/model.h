@@ -39,23 +39,62 @@ public:
     vector<Mesh> meshes;
     string directory;
     bool gammaCorrection;
+    // reorder each mesh for the vertex cache and overdraw when it is uploaded, see Mesh::optimize
+    bool optimizeMeshes;
+    // bounding sphere and axis aligned box of all meshes, in model space
+    glm::vec3 center;
+    float radius;
+    glm::vec3 box_min, box_max;
     
     /*  Functions   */
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, bool optimize = false) : gammaCorrection(gamma), optimizeMeshes(optimize), center(0.0f), radius(0), box_min(0.0f), box_max(0.0f)
     {
         loadModel(path);
+        computeBounds();
     }
     
     // draws the model, and thus all its meshes
-    void Draw(Shader shader)
+    void Draw(const Shader &shader)
     {
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].Draw(shader);
     }
     
+    // the index buffer report of every mesh, one line each
+    string indexReport() const
+    {
+        stringstream report;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            report << "mesh " << i << ": " << meshes[i].indexReport() << endl;
+        return report.str();
+    }
+    
+    // the vertex cache report of every mesh, one line each
+    string optimizationReport() const
+    {
+        stringstream report;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            report << "mesh " << i << ": " << meshes[i].optimizationReport() << endl;
+        return report.str();
+    }
+    
 private:
     /*  Functions   */
+    // the box around the boxes of the meshes, and the sphere around their spheres centered on it
+    void computeBounds()
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            box_min = i ? glm::min(box_min, meshes[i].box_min) : meshes[i].box_min;
+            box_max = i ? glm::max(box_max, meshes[i].box_max) : meshes[i].box_max;
+        }
+        center = (box_min + box_max) * 0.5f;
+        radius = 0;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            radius = max(radius, glm::length(meshes[i].center - center) + meshes[i].radius);
+    }
+    
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
@@ -171,7 +210,7 @@ private:
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
         
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(vertices, indices, textures, optimizeMeshes);
     }
     
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -190,6 +229,7 @@ private:
                 if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
                 {
                     textures.push_back(textures_loaded[j]);
+                    textures.back().unit = samplerUnit(typeName, i + 1);
                     skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
                     break;
                 }
@@ -199,6 +239,7 @@ private:
                 Texture texture;
                 texture.id = TextureFromFile(str.C_Str(), this->directory);
                 texture.type = typeName;
+                texture.unit = samplerUnit(typeName, i + 1); // resolved once here, Mesh::Draw only binds
                 texture.path = str.C_Str();
                 textures.push_back(texture);
                 textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
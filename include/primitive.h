@@ -10,219 +10,204 @@
 #define primitive_h
 
 #include <mesh.h>
+#include <ring.h>
+#include <threadpool.h>
 #include <glad/glad.h> // holds all OpenGL type declarations
 #include <glm/glm.hpp>
 
 #include <cmath>
 #include <cassert>
 #include <algorithm>
+#include <type_traits>
 
 using namespace std;
 
 enum Shape {RECTANGULAR_PLANE, ELLIPTICAL_PLANE, CUBOID, ELLIPSOID, CYLINDER, CONE, TORUS};
-enum Normal {ELLIPTICAL_PLANE_NORMAL, ELLIPSOID_NORMAL, CYLINDER_NORMAL, CONE_NORMAL, TORUS_NORMAL};
-enum Uvmap {FACE, PROJECT, UNWRAP};
+//NO_UVMAP leaves the texture coordinates at zero
+enum Uvmap {FACE, PROJECT, UNWRAP, NO_UVMAP};
+//primitives never fill tangents, they upload the rest of Vertex unless asked for another format
+const unsigned int PRIMITIVE_FORMAT = VERTEX_POSITION | VERTEX_NORMAL | VERTEX_UV;
+
+//the parameters a primitive's geometry is generated from, primitives with equal keys have identical meshes
+struct PrimitiveKey {
+    Shape sh;
+    bool smooth;
+    float dim[3];
+    int subd[2];
+    //faceted look from the smooth mesh, see Mesh::flat
+    bool flat;
+    //vertex format of the uploaded mesh
+    unsigned int format;
+    //upload reordered for the vertex cache and overdraw, see Mesh::optimize
+    bool optimize;
+    //upload the lateral grid as triangle strips, see Mesh::strips
+    bool strips;
+    //coarser levels of detail built along with the mesh, see Primitive::buildLods
+    unsigned int lods;
+    //largest distance from the exact surface in model units, curved shapes pick their subdivisions and
+    //place their vertices by curvature to stay within it, see Primitive::fitTolerance. 0 keeps subd
+    float tolerance;
+    bool operator<(const PrimitiveKey& o) const {
+        if (sh != o.sh) { return sh < o.sh; }
+        if (smooth != o.smooth) { return smooth < o.smooth; }
+        if (flat != o.flat) { return flat < o.flat; }
+        if (format != o.format) { return format < o.format; }
+        if (optimize != o.optimize) { return optimize < o.optimize; }
+        if (strips != o.strips) { return strips < o.strips; }
+        if (lods != o.lods) { return lods < o.lods; }
+        if (tolerance != o.tolerance) { return tolerance < o.tolerance; }
+        for (int i = 0; i < 3; i++) {
+            if (dim[i] != o.dim[i]) { return dim[i] < o.dim[i]; }
+        }
+        for (int i = 0; i < 2; i++) {
+            if (subd[i] != o.subd[i]) { return subd[i] < o.subd[i]; }
+        }
+        return false;
+    }
+};
+
+//corners of the unit shapes with fixed topology, scaled by dim, and their triangles
+constexpr float RECTANGULAR_PLANE_CORNERS[4][2] = {{0.5, -0.5}, {0.5, 0.5}, {-0.5, 0.5}, {-0.5, -0.5}};
+constexpr unsigned int RECTANGULAR_PLANE_INDICES[6] = {0, 1, 2, 2, 3, 0};
+constexpr float CUBOID_CORNERS[8][3] = {
+    {0.5, -0.5, -0.5}, {0.5, 0.5, -0.5}, {-0.5, 0.5, -0.5}, {-0.5, -0.5, -0.5},
+    {0.5, -0.5, 0.5}, {0.5, 0.5, 0.5}, {-0.5, 0.5, 0.5}, {-0.5, -0.5, 0.5}
+};
+constexpr unsigned int CUBOID_INDICES[36] = {
+    //bottom face
+    0, 1, 2, 2, 3, 0,
+    //lateral faces
+    0, 4, 5, 5, 1, 0,
+    1, 5, 6, 6, 2, 1,
+    2, 6, 7, 7, 3, 2,
+    3, 7, 4, 4, 0, 3,
+    //top face
+    4, 5, 6, 6, 7, 4
+};
+
+//Vertex and index counts of the smooth (unfaceted) mesh of a shape, from its subdivisions d1 and d2.
+//A ring of subdivision d has 4 (d + 1) vertices.
+template <Shape S> struct ShapeTopology;
+template <> struct ShapeTopology<RECTANGULAR_PLANE> {
+    static constexpr unsigned int vertices(unsigned int, unsigned int) { return 4; }
+    static constexpr unsigned int indices(unsigned int, unsigned int) { return 6; }
+};
+//center and one ring, a fan of triangles
+template <> struct ShapeTopology<ELLIPTICAL_PLANE> {
+    static constexpr unsigned int vertices(unsigned int d1, unsigned int) { return 1 + 4 * (d1 + 1); }
+    static constexpr unsigned int indices(unsigned int d1, unsigned int) { return 3 * 4 * (d1 + 1); }
+};
+template <> struct ShapeTopology<CUBOID> {
+    static constexpr unsigned int vertices(unsigned int, unsigned int) { return 8; }
+    static constexpr unsigned int indices(unsigned int, unsigned int) { return 36; }
+};
+//poles and 2 d2 + 1 rings, two fans and 2 d2 rows of quads
+template <> struct ShapeTopology<ELLIPSOID> {
+    static constexpr unsigned int vertices(unsigned int d1, unsigned int d2) { return 2 + (2 * d2 + 1) * 4 * (d1 + 1); }
+    static constexpr unsigned int indices(unsigned int d1, unsigned int d2) { return 6 * 4 * (d1 + 1) * (2 * d2 + 1); }
+};
+//cap centers and two rings, two fans and a row of quads
+template <> struct ShapeTopology<CYLINDER> {
+    static constexpr unsigned int vertices(unsigned int d1, unsigned int) { return 2 + 2 * 4 * (d1 + 1); }
+    static constexpr unsigned int indices(unsigned int d1, unsigned int) { return 12 * 4 * (d1 + 1); }
+};
+//base center, apex and one ring, two fans
+template <> struct ShapeTopology<CONE> {
+    static constexpr unsigned int vertices(unsigned int d1, unsigned int) { return 2 + 4 * (d1 + 1); }
+    static constexpr unsigned int indices(unsigned int d1, unsigned int) { return 6 * 4 * (d1 + 1); }
+};
+//4 (d2 + 1) rings, wrapped in both directions
+template <> struct ShapeTopology<TORUS> {
+    static constexpr unsigned int vertices(unsigned int d1, unsigned int d2) { return 16 * (d1 + 1) * (d2 + 1); }
+    static constexpr unsigned int indices(unsigned int d1, unsigned int d2) { return 6 * 16 * (d1 + 1) * (d2 + 1); }
+};
+
+template <Shape S, Uvmap UV, bool Smooth> struct PrimitiveGen;
+template <Shape S, Uvmap UV> struct UvmapGen;
 
 class Primitive : public Mesh {
     typedef unsigned int uint;
+    template <Shape, Uvmap, bool> friend struct PrimitiveGen;
+    template <Shape, Uvmap> friend struct UvmapGen;
 public:
     Shape sh;
     float dim[3];
     int subd[2];
     bool smooth;
+    //chord error the vertices were placed for, 0 when the subdivisions were given
+    float tolerance;
     explicit Primitive(Shape s, bool sm = false, float a = 1.0, float b = 1.0, float c = 1.0, uint d1 = 1.0, uint d2 = 1.0) : Mesh() {
+        generate(makeKey(s, sm, a, b, c, d1, d2), NO_UVMAP);
+    }
+    //a primitive built without upload only has its cpu side data, see buildLods
+    explicit Primitive(const PrimitiveKey& k, Uvmap uv = NO_UVMAP, bool upload = true) : Mesh() {
+        generate(k, uv, upload);
+    }
+    //the key of the primitive the constructor arguments describe, fields a shape does not use are fixed
+    //so that arguments which produce the same geometry produce the same key
+    static PrimitiveKey makeKey(Shape s, bool sm = false, float a = 1.0, float b = 1.0, float c = 1.0, uint d1 = 1.0, uint d2 = 1.0) {
+        PrimitiveKey k = {s, sm, {a, b, c}, {int(d1), int(d2)}, false, PRIMITIVE_FORMAT, false, false, 0, 0.0f};
         switch(s) {
-            case RECTANGULAR_PLANE: {
-                sh = s; smooth = sm; dim[0] = a; dim[1] = b; dim[2] = 0; subd[0] = 0; subd[1] = -1;
-                rectPlane();
-                break;
-            }
-            case ELLIPTICAL_PLANE: {
-                sh = s; smooth = sm; dim[0] = a; dim[1] = b; dim[2] = 0; subd[0] = uint(c); subd[1] = -1;
-                elliPlane();
-                break;
-            }
-            case CUBOID: {
-                sh = s; smooth = sm; dim[0] = a; dim[1] = b; dim[2] = c; subd[0] = 0; subd[1] = 0;
-                cuboid();
-                break;
-            }
-            case ELLIPSOID: {
-                sh = s; smooth = sm; dim[0] = a; dim[1] = b; dim[2] = c; subd[0] = d1; subd[1] = d2;
-                ellipsoid();
-                break;
-            }
-            case CYLINDER: {
-                sh = s; smooth = sm; dim[0] = a; dim[1] = b; dim[2] = c; subd[0] = d1; subd[1] = -1;
-                cylinder();
-                break;
-            }
-            case CONE: {
-                sh = s; smooth = sm; dim[0] = a; dim[1] = b; dim[2] = c; subd[0] = d1; subd[1] = -1;
-                cone();
-                break;
-            }
-            case TORUS: {
-                sh = s; smooth = sm; dim[0] = a; dim[1] = b; dim[2] = c; subd[0] = d1; subd[1] = d2;
-                torus();
-                break;
-            }
-            default: {
-                cerr << "This shape is not recognized as a primitive." << endl;
-            }
-        }
-        if (!smooth) {
-            facet();
+            case RECTANGULAR_PLANE: { k.dim[2] = 0; k.subd[0] = 0; k.subd[1] = -1; break; }
+            case ELLIPTICAL_PLANE: { k.dim[2] = 0; k.subd[0] = uint(c); k.subd[1] = -1; break; }
+            case CUBOID: { k.subd[0] = 0; k.subd[1] = 0; break; }
+            case CYLINDER:
+            case CONE: { k.subd[1] = -1; break; }
+            default: break;
         }
-        setupMesh();
+        return k;
     }
-    void genUvmap(Uvmap uv) {
-        switch (uv) {
-            case FACE : {
-                assert(!smooth);
-                switch (sh) {
-                        //for elliptical and rectangular planes use project
-                    case ELLIPSOID :
-                    case CYLINDER : {
-                        unwrapLateralToFace(3 * 4 * (subd[0] + 1), indices.size() - 3 * 4 * (subd[0] + 1));
-                    }
-                    case CONE : {
-                        unwrapCapsToFace();
-                        break;
-                    }
-                    case CUBOID :
-                    case TORUS : {
-                        unwrapLateralToFace(0, indices.size());
-                        break;
-                    }
-                }
-                break;
-            }
-            case PROJECT : {
-                float left_d[2], wid[2];
-                switch (sh) {
-                    case ELLIPTICAL_PLANE :
-                    case ELLIPSOID :
-                    case CONE :
-                    case CYLINDER : {
-                        left_d[0] = -dim[0]; left_d[1] =  -dim[1];
-                        wid[0] = 2 * dim[0]; wid[1] = 2 * dim[1];
-                        break;
-                    }
-                    case TORUS : {
-                        left_d[0] = -dim[0] - dim[2]; left_d[1] = -dim[1] - dim[2];
-                        wid[0] = 2 * (dim[0] + dim[2]); wid[1] = 2 * (dim[1] + dim[2]);
-                        break;
-                    }
-                    case RECTANGULAR_PLANE :
-                    case CUBOID : {
-                        left_d[0] = -0.5f * dim[0]; left_d[1] = -0.5f * dim[1];
-                        wid[0] = dim[0]; wid[1] = dim[1];
-                        break;
-                    }
-                }
-                for (uint i = 0; i < vertices.size(); i++) {
-                    float x = vertices[i].Position.x, y = vertices[i].Position.y;
-                    vertices[i].TexCoords = glm::vec2((x - left_d[0]) / wid[0], (y + 0.5 * dim[1]) / wid[1]);
-                }
-                break;
-            }
-            case UNWRAP : {
-                switch (sh) {
-                    case CUBOID : {
-                        //unwrap bottom face
-                        uint idx = 0;
-                        float piece1[6][2] = {
-                            {1.0 / 4, 0.0},
-                            {1.0 / 4, 1.0 / 3},
-                            {2.0 / 4, 1.0 / 3},
-                            {2.0 / 4, 1.0 / 3},
-                            {2.0 / 4, 0.0},
-                            {1.0 / 4, 0.0},
-                        };
-                        for (uint i = 0; i < 6; i++) {
-                            vertices[indices[idx + i]].TexCoords = glm::vec2(piece1[i][0], piece1[i][1]);
-                        }
-                        //unwrap lateral faces
-                        unwrapLateralFaces(4, 1, 6, 0.0, 1.0, 1.0 / 3, 2.0 / 3);
-                        //unwrap top face
-                        idx = indices.size() - 6;
-                        float piece2[6][2] = {
-                            {1.0 / 4, 1.0},
-                            {1.0 / 4, 2.0 / 3},
-                            {2.0 / 4, 2.0 / 3},
-                            {2.0 / 4, 2.0 / 3},
-                            {2.0 / 4, 1.0},
-                            {1.0 / 4, 1.0},
-                        };
-                        for (uint i = 0; i < 6; i++) {
-                            vertices[indices[idx + i]].TexCoords = glm::vec2(piece2[i][0], piece2[i][1]);
-                        }
-                        break;
-                    }
-                    case ELLIPSOID : {
-                        uint nxy = 4 * (subd[0] + 1), nz = 2 * (subd[0] + 1);
-                        //unwrap bottom cap
-                        unwrapBottomCap(nxy, 0, 0.0, 1.0, 0.0, 1.0 / nz);
-                        //unwrap lateral faces
-                        unwrapLateralFaces(nxy, nz - 2, 3 * nxy, 0.0, 1.0, 1.0 / nz, 1.0 - 1.0 / nz);
-                        //unwrap bottom cap
-                        unwrapTopCap(nxy, indices.size() - nxy * 3, 0.0, 1.0, 1.0 - 1.0 / nz, 1.0);
-                        break;
-                    }
-                    case CYLINDER : {
-                        uint h = 2 * dim[0] + dim[2], nxy = 4 * (subd[0] + 1);
-                        //unwrap bottom cap
-                        unwrapBottomCap(nxy, 0, 0.0, 1.0, 0.0, dim[0] / h);
-                        //unwrap lateral faces
-                        unwrapLateralFaces(nxy, 1, 3 * nxy, 0.0, 1.0, dim[0] / h, 1.0 - dim[0] / h);
-                        //unwrap bottom cap
-                        unwrapTopCap(nxy, indices.size() - 3 * nxy, 0.0, 1.0, 1.0 - dim[0] / h, 1.0);
-                        break;
-                    }
-                    case CONE : {
-                        uint h = dim[0] + dim[2], nxy = 4 * (subd[0] + 1);
-                        //unwrap bottom cap
-                        unwrapBottomCap(nxy, 0, 0.0, 1.0, 0.0, dim[0] / h);
-                        //unwrap bottom cap
-                        unwrapTopCap(nxy, indices.size() - 3 * nxy, 0.0, 1.0, dim[0] / h, 1.0);
-                        break;
-                    }
-                    case TORUS : {
-                        //unwrap lateral faces
-                        unwrapLateralFaces(4 * (subd[0] + 1), 4 * (subd[1] + 1));
-                        break;
-                    }
-                }
-                break;
-            }
-        }
-        setupMesh();
+    PrimitiveKey key() const {
+        PrimitiveKey k = {sh, smooth, {dim[0], dim[1], dim[2]}, {subd[0], subd[1]}, flat, format, optimize, strips, lod_levels, tolerance};
+        return k;
     }
-    void addTexture(uint texid, string textype) {
-        Texture* tex = new Texture;
-        tex->id = texid;
-        tex->type = textype;
-        textures.push_back(*tex);
+    //replace the texture coordinates and send them to the buffers the mesh already has
+    void genUvmap(Uvmap uv);
+    //build the primitive of k into this mesh instead, e.g. with other subdivisions, keeping its vertex
+    //array and buffers. Only for meshes private to the caller, see GeometryCache::modify
+    void rebuild(const PrimitiveKey& k, Uvmap uv = NO_UVMAP) {
+        vertices.clear();
+        indices.clear();
+        generate(k, uv);
     }
-    
+    //how far the mesh may lie from the exact surface: the sagitta of the coarsest arc between two
+    //neighbouring vertices of a ring
+    float chordError() const;
+    //the subdivisions that keep the primitive of k within k.tolerance of its exact surface. Every chord of
+    //a ring or meridian gets an equal share of the curvature, a chord cutting off an integral s of
+    //sqrt(curvature) along the curve has a sagitta of about s^2 / 8. Half the tolerance goes to each
+    //direction, the ring gets all of it on elliptical planes, cylinders and cones whose sides are straight.
+    //Planes and cuboids get tolerance 0 and keep their subdivisions
+    static void fitTolerance(PrimitiveKey& k);
+
 private:
     vector<Vertex> buffer_vertices;
     vector<uint> buffer_indices;
+    //cos and sin of the ring angles, shared by all rings of the primitive
+    RingTable ring;
+    //levels of detail asked for, fewer are built once the subdivisions cannot shrink any further
+    uint lod_levels;
+    //the runtime shape, smooth flag and uv map pick the PrimitiveGen that builds the mesh
+    void generate(const PrimitiveKey& k, Uvmap uv, bool upload = true);
+    void buildLods(Uvmap uv);
+    //parameters of the n + 1 rows of a meridian of the ellipsoid, pole to pole, by curvature
+    static vector<double> ellipsoidRows(float a, float b, float c, uint n);
+    template <Shape S> void generateShape(Uvmap uv);
+    template <Shape S> void applyUvmap(Uvmap uv);
     void rectPlane() {
         //creating vertices and normals
-        float l[] = {0.5, 0.5, -0.5, -0.5}, w[] = {-0.5, 0.5, 0.5, -0.5};
         for (uint i = 0; i < 4; i++) {
-            pushVertex(glm::vec3(dim[0] * l[i], dim[1] * w[i], 0.0), glm::vec3(0.0, 0.0, 1.0));
+            pushVertex(glm::vec3(dim[0] * RECTANGULAR_PLANE_CORNERS[i][0], dim[1] * RECTANGULAR_PLANE_CORNERS[i][1], 0.0), glm::vec3(0.0, 0.0, 1.0));
         }
         //face
-        pushFace(0, 1, 2, 3);
+        indices.assign(RECTANGULAR_PLANE_INDICES, RECTANGULAR_PLANE_INDICES + 6);
     }
     void elliPlane() {
         //creating vertices and normals
         //center vertex
         pushVertex(glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0, 0.0, 1.0));
         //lateral vertices
+        adaptRing();
         pushEllipse(dim[0], dim[1], 0.0, subd[0], ELLIPTICAL_PLANE_NORMAL);
         //cap
         pushBottomCap(subd[0]);
@@ -230,32 +215,36 @@ private:
     }
     void cuboid() {
         //creating vertices and normals
-        float l[] = {0.5, 0.5, -0.5, -0.5}, w[] = {-0.5, 0.5, 0.5, -0.5}, h[] = {-0.5, 0.5};
         for (uint i = 0; i < 8; i++) {
-            glm::vec3 pos = glm::vec3(dim[0] * l[i % 4], dim[1] * w[i % 4], dim[2] * h[i / 4]);
+            glm::vec3 pos = glm::vec3(dim[0] * CUBOID_CORNERS[i][0], dim[1] * CUBOID_CORNERS[i][1], dim[2] * CUBOID_CORNERS[i][2]);
             pushVertex(pos, glm::normalize(pos));
         }
-        //bottom face
-        pushFace(0, 1, 2, 3);
-        //lateral faces
-        pushArrayFaces(0, 4, 2, true, false);
-        //top face
-        pushFace(4, 5, 6, 7);
+        //bottom, lateral and top faces
+        indices.assign(CUBOID_INDICES, CUBOID_INDICES + 36);
     }
     void ellipsoid() {
         //creating vertices and normals
         uint nxy = 4 * (subd[0] + 1), nz = 2 * (subd[1] + 1);
         float pi = acos(-1);
+        vector<double> rows(nz + 1);
+        for (uint i = 0; i <= nz; i++) { rows[i] = -pi / 2 + i * pi / nz; }
+        if (tolerance > 0) {
+            ring = RingTable(nxy, dim[0], dim[1]);
+            rows = ellipsoidRows(dim[0], dim[1], dim[2], nz);
+        }
         //bottom vertex
         pushVertex(glm::vec3(0.0, 0.0, -dim[2]), glm::vec3(0.0, 0.0, -1.0));
-        //lateral vertices
-        for (uint i = 1; i < nz; i++) {
-            float thetaz = -pi / 2 + i * pi / nz;
-            float z = dim[2] * sin(thetaz);
-            float rx = dim[0] * sqrt(1 - (z * z) / (dim[2] * dim[2]));
-            float ry = dim[1] * sqrt(1 - (z * z) / (dim[2] * dim[2]));
-            pushEllipse(rx, ry, z, subd[0], ELLIPSOID_NORMAL);
-        }
+        //lateral vertices, a ring per row
+        Vertex* rings = pushRings(nz - 1, subd[0]);
+        parallelRows(1, nz, nxy, [&](uint lo, uint hi) {
+            for (uint i = lo; i < hi; i++) {
+                float thetaz = rows[i];
+                float z = dim[2] * sin(thetaz);
+                float rx = dim[0] * sqrt(1 - (z * z) / (dim[2] * dim[2]));
+                float ry = dim[1] * sqrt(1 - (z * z) / (dim[2] * dim[2]));
+                emitRing(ring, rx, ry, z, ELLIPSOID_NORMAL, rings + (i - 1) * nxy, dim[0], dim[1]);
+            }
+        });
         //top vertex
         pushVertex(glm::vec3(0.0, 0.0, dim[2]), glm::vec3(0.0, 0.0, 1));
         //bottom cap
@@ -269,6 +258,7 @@ private:
         //bottom vertex
         pushVertex(glm::vec3(0.0, 0.0, -dim[2] / 2), glm::vec3(0.0, 0.0, -1.0));
         //lateral vertices
+        adaptRing();
         pushEllipse(dim[0], dim[1], -dim[2] / 2, subd[0], CYLINDER_NORMAL);
         pushEllipse(dim[0], dim[1], dim[2] / 2, subd[0], CYLINDER_NORMAL);
         //top vertex
@@ -285,6 +275,7 @@ private:
         //bottom vertex
         pushVertex(glm::vec3(0.0, 0.0, -dim[2] / 3), glm::vec3(0.0, 0.0, -1.0));
         //lateral vertices
+        adaptRing();
         pushEllipse(dim[0], dim[1], -dim[2] / 3, subd[0], CONE_NORMAL);
         //top vertex
         pushVertex(glm::vec3(0.0, 0.0, 2 * dim[2] / 3), glm::vec3(0.0, 0.0, 1.0));
@@ -296,10 +287,15 @@ private:
     void torus() {
         uint nxy = 4 * (subd[0] + 1), nz = 4 * (subd[1] + 1);
         float pi = acos(-1);
-        for (uint i = 0; i < nz; i++) {
-            float theta = 2 * i * pi / nz, t = cos(theta), u = sin(theta);
-            pushEllipse(dim[0] - dim[2] * t, dim[1] - dim[2] * t, dim[2] * u, subd[0], TORUS_NORMAL);
-        }
+        //the outer equator bends the most for the same angle, the tube is a circle and stays uniform
+        if (tolerance > 0) { ring = RingTable(nxy, dim[0] + dim[2], dim[1] + dim[2]); }
+        Vertex* rings = pushRings(nz, subd[0]);
+        parallelRows(0, nz, nxy, [&](uint lo, uint hi) {
+            for (uint i = lo; i < hi; i++) {
+                float theta = 2 * i * pi / nz, t = cos(theta), u = sin(theta);
+                emitRing(ring, dim[0] - dim[2] * t, dim[1] - dim[2] * t, dim[2] * u, TORUS_NORMAL, rings + i * nxy, dim[0], dim[1]);
+            }
+        });
         //FACES
         pushArrayFaces(0, nxy, nz, true, true);
     }
@@ -307,19 +303,27 @@ private:
     void facet() {
         swap(vertices, buffer_vertices);
         swap(indices, buffer_indices);
-        vertices.clear();
-        indices.clear();
-        for (uint i = 0; i < buffer_indices.size(); i += 3) {
-            glm::vec3 p1 = buffer_vertices[buffer_indices[i]].Position;
-            glm::vec3 p2 = buffer_vertices[buffer_indices[i + 1]].Position;
-            glm::vec3 p3 = buffer_vertices[buffer_indices[i + 2]].Position;
-            glm::vec3 n = cross(p2 - p1, p3 - p2);
-            if (glm::dot(n, p1) < 0) { n = -n; }
-            pushVertex(p1, n);
-            pushVertex(p2, n);
-            pushVertex(p3, n);
-            indices.insert(indices.end(), {i, i + 1, i + 2});
-        }
+        //faceted triangles share no vertices, there is no grid left to strip
+        grids.clear();
+        //every triangle gets its own three vertices, triangle t owns slots 3t to 3t + 2 of both arrays
+        vertices.resize(buffer_indices.size());
+        indices.resize(buffer_indices.size());
+        parallelRows(0, buffer_indices.size() / 3, 3, [&](uint lo, uint hi) {
+            for (uint i = 3 * lo; i < 3 * hi; i += 3) {
+                glm::vec3 p1 = buffer_vertices[buffer_indices[i]].Position;
+                glm::vec3 p2 = buffer_vertices[buffer_indices[i + 1]].Position;
+                glm::vec3 p3 = buffer_vertices[buffer_indices[i + 2]].Position;
+                glm::vec3 n = cross(p2 - p1, p3 - p2);
+                if (glm::dot(n, p1) < 0) { n = -n; }
+                setVertex(vertices[i], p1, n);
+                setVertex(vertices[i + 1], p2, n);
+                setVertex(vertices[i + 2], p3, n);
+                indices[i] = i; indices[i + 1] = i + 1; indices[i + 2] = i + 2;
+            }
+        });
+        //the smooth mesh is not needed anymore
+        vector<Vertex>().swap(buffer_vertices);
+        vector<uint>().swap(buffer_indices);
     }
     
     
@@ -400,63 +404,64 @@ private:
         }
     }
     
+    //with a tolerance, place the vertices of the ring of a shape with straight sides by the curvature of
+    //its ellipse
+    void adaptRing() {
+        if (tolerance > 0) { ring = RingTable(4 * (subd[0] + 1), dim[0], dim[1]); }
+    }
+    
     void pushEllipse(float a, float b, float z, uint d, Normal n) {
-        int nxy = 4 * (d + 1);
-        for (uint i = 0; i < nxy; i++) {
-            pushVertex(getEllipticCoord(a, b, z, i, nxy), normals(a, b, z, i, nxy, n));
-        }
+        emitRing(ring, a, b, z, n, pushRings(1, d), dim[0], dim[1]);
     }
     
-    void pushVertex(glm::vec3 p, glm::vec3 n) {
-        Vertex* vert = new Vertex;
-        vert->Position = p;
-        vert->Normal = glm::normalize(n);
-        vertices.push_back(*vert);
+    //append room for count rings of subdivision d for emitRing to fill, and make ring match d
+    Vertex* pushRings(uint count, uint d) {
+        uint nxy = 4 * (d + 1), first = vertices.size();
+        if (ring.size() != nxy) { ring = RingTable(nxy); }
+        //the builders reserved room for the whole primitive, this does not reallocate
+        vertices.resize(first + count * nxy);
+        return &vertices[first];
     }
     
-    glm::vec3 normals(float a, float b, float z, uint i, uint nxy, Normal n) {
-        switch(n) {
-            case TORUS_NORMAL : return glm::normalize(getEllipticCoord(a, b, z, i, nxy) - getEllipticCoord(dim[0], dim[1], 0, i, nxy));
-            case ELLIPSOID_NORMAL : return glm::normalize(getEllipticCoord(a, b, z, i, nxy));
-            case ELLIPTICAL_PLANE_NORMAL : return glm::vec3(0.0, 0.0, 1.0);
-            case CYLINDER_NORMAL : return glm::normalize(glm::vec3(0.0, 0.0, z) - glm::vec3(0.0, 0.0, 0.0));
-            case CONE_NORMAL : return glm::normalize(getEllipticCoord(a, b, z, i, nxy) - glm::vec3(0.0, 0.0, 0.0));
-        }
-        return glm::vec3(0.0, 0.0, 1.0);
+    //chunks of parallel work hold at least this many elements, smaller primitives are built on the calling thread
+    static const uint PARALLEL_GRAIN = 1 << 14;
+    //run fn over the rows [begin, end) of row_size elements on the shared pool. Every row writes its own
+    //slice of the output, so the result does not depend on how rows are split between threads.
+    void parallelRows(uint begin, uint end, uint row_size, const ThreadPool::RangeFunction& fn) {
+        ThreadPool::shared().parallelFor(begin, end, max(1u, PARALLEL_GRAIN / max(1u, row_size)), fn);
     }
     
-    glm::vec3 getEllipticCoord(float a, float b, float z, uint i, uint nxy) {
-        float pi = acos(-1), x, y;
-        if (i == nxy / 4 || i == 3 * nxy / 4) {
-            //to handle overflows at theta = pi/2 && theta = 3pi/2
-            x = 0.0; y = (i == nxy / 4 ? b : -b);
-        } else {
-            float theta = 2 * i * pi / nxy, m = tan(theta);
-            x = 1 / sqrt(1 / (a * a) + (double(m) * m) / (b * b));
-            if (pi / 2 < theta && theta < 3 * pi / 2) { x = -x; }
-            y = m * x;
-        }
-        return glm::vec3(x, y, z);
+    void pushVertex(glm::vec3 p, glm::vec3 n) {
+        vertices.push_back(Vertex());
+        setVertex(vertices.back(), p, n);
     }
     
-    void pushArrayFaces(uint vbegin, uint nxy, uint nz, bool wrapxy, bool wrapz) {
-        for (uint i = 0; i < nz; i++) {
-            if (i == nz - 1 && !wrapz) { continue; }
-            for (uint j = 0; j < nxy; j++) {
-                if (j == nxy - 1 && !wrapxy) { continue; }
-                //quad with vertices a b c d
-                uint a = vbegin + nxy * i + j;
-                uint b = vbegin + nxy * ((i + 1) % nz) + j;
-                uint c = vbegin + nxy * ((i + 1) % nz) + (j + 1) % nxy;
-                uint d = vbegin + nxy * i + (j + 1) % nxy;
-                pushFace(a, b, c, d);
-            }
-        }
+    static void setVertex(Vertex& vert, glm::vec3 p, glm::vec3 n) {
+        vert = Vertex();
+        vert.Position = p;
+        vert.Normal = glm::normalize(n);
     }
     
-    void pushFace(uint a, uint b, uint c, uint d) {
-        indices.insert(indices.end(), {a, b, c});
-        indices.insert(indices.end(), {c, d, a});
+    void pushArrayFaces(uint vbegin, uint nxy, uint nz, bool wrapxy, bool wrapz) {
+        uint rows = wrapz ? nz : nz - 1, cols = wrapxy ? nxy : nxy - 1, first = indices.size();
+        indices.resize(first + 6 * rows * cols);
+        //remembered so the grid can be uploaded as strips
+        QuadGrid grid = {first, 6 * rows * cols, vbegin, nxy, nz, wrapxy, wrapz};
+        grids.push_back(grid);
+        parallelRows(0, rows, 6 * cols, [&](uint lo, uint hi) {
+            for (uint i = lo; i < hi; i++) {
+                uint* out = &indices[first + 6 * cols * i];
+                for (uint j = 0; j < cols; j++, out += 6) {
+                    //quad with vertices a b c d
+                    uint a = vbegin + nxy * i + j;
+                    uint b = vbegin + nxy * ((i + 1) % nz) + j;
+                    uint c = vbegin + nxy * ((i + 1) % nz) + (j + 1) % nxy;
+                    uint d = vbegin + nxy * i + (j + 1) % nxy;
+                    out[0] = a; out[1] = b; out[2] = c;
+                    out[3] = c; out[4] = d; out[5] = a;
+                }
+            }
+        });
     }
     
     void pushTopCap(uint d) {
@@ -479,4 +484,334 @@ private:
     }
 };
 
+//Builds primitives of shape S with uv map UV, smooth or faceted. The counts of the finished mesh are
+//known at compile time, so fixed shapes can be checked statically and the builders reserve exactly once.
+template <Shape S, Uvmap UV, bool Smooth>
+struct PrimitiveGen {
+    typedef ShapeTopology<S> Topology;
+    //faceting gives every index its own vertex
+    static constexpr unsigned int vertexCount(unsigned int d1, unsigned int d2) {
+        return Smooth ? Topology::vertices(d1, d2) : Topology::indices(d1, d2);
+    }
+    static constexpr unsigned int indexCount(unsigned int d1, unsigned int d2) {
+        return Topology::indices(d1, d2);
+    }
+    //fill p, whose shape parameters are set, with its vertices, indices and texture coordinates
+    static void build(Primitive& p) {
+        unsigned int d1 = p.subd[0], d2 = p.subd[1];
+        //reserve once, the builders then never reallocate
+        p.vertices.reserve(Topology::vertices(d1, d2));
+        p.indices.reserve(Topology::indices(d1, d2));
+        emit(p, integral_constant<Shape, S>());
+        assert(p.vertices.size() == Topology::vertices(d1, d2) && p.indices.size() == Topology::indices(d1, d2));
+        p.ring = RingTable();
+        if (!Smooth) {
+            p.facet();
+        }
+        UvmapGen<S, UV>::apply(p);
+    }
+private:
+    static void emit(Primitive& p, integral_constant<Shape, RECTANGULAR_PLANE>) { p.rectPlane(); }
+    static void emit(Primitive& p, integral_constant<Shape, ELLIPTICAL_PLANE>) { p.elliPlane(); }
+    static void emit(Primitive& p, integral_constant<Shape, CUBOID>) { p.cuboid(); }
+    static void emit(Primitive& p, integral_constant<Shape, ELLIPSOID>) { p.ellipsoid(); }
+    static void emit(Primitive& p, integral_constant<Shape, CYLINDER>) { p.cylinder(); }
+    static void emit(Primitive& p, integral_constant<Shape, CONE>) { p.cone(); }
+    static void emit(Primitive& p, integral_constant<Shape, TORUS>) { p.torus(); }
+};
+
+static_assert(PrimitiveGen<RECTANGULAR_PLANE, NO_UVMAP, true>::vertexCount(0, 0) == 4, "a rectangle has 4 corners");
+static_assert(PrimitiveGen<CUBOID, NO_UVMAP, true>::vertexCount(0, 0) == 8, "a cuboid has 8 corners");
+static_assert(PrimitiveGen<CUBOID, NO_UVMAP, false>::vertexCount(0, 0) == 36, "a faceted cuboid has 3 vertices per triangle");
+
+//Texture coordinates of uv map UV on shape S. Pairs without a specialization have no such map
+//(for elliptical and rectangular planes use project) and leave the coordinates alone.
+template <Shape S, Uvmap UV>
+struct UvmapGen {
+    static void apply(Primitive&) {}
+};
+
+//one texture per face: every quad of the lateral grid, and every cap triangle, gets the whole texture
+template <Shape S>
+struct UvmapGen<S, FACE> {
+    static void apply(Primitive& p) {
+        assert(!p.smooth);
+        unsigned int cap = 3 * 4 * (p.subd[0] + 1);
+        if (S == ELLIPSOID || S == CYLINDER) { p.unwrapLateralToFace(cap, p.indices.size() - cap); }
+        if (S == ELLIPSOID || S == CYLINDER || S == CONE) { p.unwrapCapsToFace(); }
+        if (S == CUBOID || S == TORUS) { p.unwrapLateralToFace(0, p.indices.size()); }
+    }
+};
+
+//the texture is projected along z onto the bounding rectangle of the shape
+template <Shape S>
+struct UvmapGen<S, PROJECT> {
+    static void apply(Primitive& p) {
+        float left_d[2], wid[2];
+        const float* dim = p.dim;
+        if (S == TORUS) {
+            left_d[0] = -dim[0] - dim[2]; left_d[1] = -dim[1] - dim[2];
+            wid[0] = 2 * (dim[0] + dim[2]); wid[1] = 2 * (dim[1] + dim[2]);
+        } else if (S == RECTANGULAR_PLANE || S == CUBOID) {
+            left_d[0] = -0.5f * dim[0]; left_d[1] = -0.5f * dim[1];
+            wid[0] = dim[0]; wid[1] = dim[1];
+        } else {
+            left_d[0] = -dim[0]; left_d[1] =  -dim[1];
+            wid[0] = 2 * dim[0]; wid[1] = 2 * dim[1];
+        }
+        vector<Vertex>& vertices = p.vertices;
+        p.parallelRows(0, vertices.size(), 1, [&](unsigned int lo, unsigned int hi) {
+            for (unsigned int i = lo; i < hi; i++) {
+                float x = vertices[i].Position.x, y = vertices[i].Position.y;
+                vertices[i].TexCoords = glm::vec2((x - left_d[0]) / wid[0], (y + 0.5 * dim[1]) / wid[1]);
+            }
+        });
+    }
+};
+
+//the cuboid's net: bottom face, a strip of lateral faces, top face
+template <>
+struct UvmapGen<CUBOID, UNWRAP> {
+    static void apply(Primitive& p) {
+        //unwrap bottom face
+        unsigned int idx = 0;
+        float piece1[6][2] = {
+            {1.0 / 4, 0.0},
+            {1.0 / 4, 1.0 / 3},
+            {2.0 / 4, 1.0 / 3},
+            {2.0 / 4, 1.0 / 3},
+            {2.0 / 4, 0.0},
+            {1.0 / 4, 0.0},
+        };
+        for (unsigned int i = 0; i < 6; i++) {
+            p.vertices[p.indices[idx + i]].TexCoords = glm::vec2(piece1[i][0], piece1[i][1]);
+        }
+        //unwrap lateral faces
+        p.unwrapLateralFaces(4, 1, 6, 0.0, 1.0, 1.0 / 3, 2.0 / 3);
+        //unwrap top face
+        idx = p.indices.size() - 6;
+        float piece2[6][2] = {
+            {1.0 / 4, 1.0},
+            {1.0 / 4, 2.0 / 3},
+            {2.0 / 4, 2.0 / 3},
+            {2.0 / 4, 2.0 / 3},
+            {2.0 / 4, 1.0},
+            {1.0 / 4, 1.0},
+        };
+        for (unsigned int i = 0; i < 6; i++) {
+            p.vertices[p.indices[idx + i]].TexCoords = glm::vec2(piece2[i][0], piece2[i][1]);
+        }
+    }
+};
+
+template <>
+struct UvmapGen<ELLIPSOID, UNWRAP> {
+    static void apply(Primitive& p) {
+        unsigned int nxy = 4 * (p.subd[0] + 1), nz = 2 * (p.subd[1] + 1);
+        //unwrap bottom cap
+        p.unwrapBottomCap(nxy, 0, 0.0, 1.0, 0.0, 1.0 / nz);
+        //unwrap lateral faces
+        p.unwrapLateralFaces(nxy, nz - 2, 3 * nxy, 0.0, 1.0, 1.0 / nz, 1.0 - 1.0 / nz);
+        //unwrap top cap
+        p.unwrapTopCap(nxy, p.indices.size() - nxy * 3, 0.0, 1.0, 1.0 - 1.0 / nz, 1.0);
+    }
+};
+
+template <>
+struct UvmapGen<CYLINDER, UNWRAP> {
+    static void apply(Primitive& p) {
+        float h = 2 * p.dim[0] + p.dim[2];
+        unsigned int nxy = 4 * (p.subd[0] + 1);
+        //unwrap bottom cap
+        p.unwrapBottomCap(nxy, 0, 0.0, 1.0, 0.0, p.dim[0] / h);
+        //unwrap lateral faces
+        p.unwrapLateralFaces(nxy, 1, 3 * nxy, 0.0, 1.0, p.dim[0] / h, 1.0 - p.dim[0] / h);
+        //unwrap top cap
+        p.unwrapTopCap(nxy, p.indices.size() - 3 * nxy, 0.0, 1.0, 1.0 - p.dim[0] / h, 1.0);
+    }
+};
+
+template <>
+struct UvmapGen<CONE, UNWRAP> {
+    static void apply(Primitive& p) {
+        float h = p.dim[0] + p.dim[2];
+        unsigned int nxy = 4 * (p.subd[0] + 1);
+        //unwrap bottom cap
+        p.unwrapBottomCap(nxy, 0, 0.0, 1.0, 0.0, p.dim[0] / h);
+        //unwrap top cap
+        p.unwrapTopCap(nxy, p.indices.size() - 3 * nxy, 0.0, 1.0, p.dim[0] / h, 1.0);
+    }
+};
+
+template <>
+struct UvmapGen<TORUS, UNWRAP> {
+    static void apply(Primitive& p) {
+        //unwrap lateral faces
+        p.unwrapLateralFaces(4 * (p.subd[0] + 1), 4 * (p.subd[1] + 1));
+    }
+};
+
+inline void Primitive::generate(const PrimitiveKey& requested, Uvmap uv, bool upload) {
+    PrimitiveKey k = requested;
+    fitTolerance(k);
+    tolerance = k.tolerance;
+    sh = k.sh; smooth = k.smooth; format = k.format; optimize = k.optimize; strips = k.strips; lod_levels = k.lods;
+    grids.clear();
+    //uv maps that give each face corner its own coordinates need the faceted mesh
+    flat = k.flat && !k.smooth && uv != FACE && uv != UNWRAP;
+    dim[0] = k.dim[0]; dim[1] = k.dim[1]; dim[2] = k.dim[2];
+    subd[0] = k.subd[0]; subd[1] = k.subd[1];
+    switch(sh) {
+        case RECTANGULAR_PLANE: { generateShape<RECTANGULAR_PLANE>(uv); break; }
+        case ELLIPTICAL_PLANE: { generateShape<ELLIPTICAL_PLANE>(uv); break; }
+        case CUBOID: { generateShape<CUBOID>(uv); break; }
+        case ELLIPSOID: { generateShape<ELLIPSOID>(uv); break; }
+        case CYLINDER: { generateShape<CYLINDER>(uv); break; }
+        case CONE: { generateShape<CONE>(uv); break; }
+        case TORUS: { generateShape<TORUS>(uv); break; }
+        default: {
+            cerr << "This shape is not recognized as a primitive." << endl;
+        }
+    }
+    buildLods(uv);
+    if (upload) { setupMesh(); }
+}
+
+//every level halves the ring segments of the one before (or quadruples its tolerance), until a shape's subdivisions reach 0. Levels
+//are whole primitives of their own with the same uv map, they only share the mesh's buffers
+inline void Primitive::buildLods(Uvmap uv) {
+    //levels that keep their vertex count keep their place in the buffers, so updateVertices can refresh them
+    vector<MeshLevel> uploaded;
+    uploaded.swap(lods);
+    PrimitiveKey k = key();
+    k.lods = 0;
+    for (uint l = 0; l < lod_levels; l++) {
+        PrimitiveKey coarse = k;
+        if (k.tolerance > 0) {
+            //half the chords, four times the sagitta
+            coarse.tolerance = 4 * k.tolerance;
+            fitTolerance(coarse);
+        } else {
+            for (uint i = 0; i < 2; i++) {
+                if (k.subd[i] > 0) { coarse.subd[i] = (k.subd[i] + 1) / 2 - 1; }
+            }
+        }
+        if (coarse.subd[0] == k.subd[0] && coarse.subd[1] == k.subd[1]) { break; }
+        Primitive level(coarse, uv, false);
+        lods.push_back(MeshLevel());
+        MeshLevel& m = lods.back();
+        m.vertices.swap(level.vertices);
+        m.indices.swap(level.indices);
+        m.grids.swap(level.grids);
+        m.error = level.chordError();
+        m.base_vertex = 0;
+        if (l < uploaded.size() && uploaded[l].vertices.size() == m.vertices.size()) {
+            m.base_vertex = uploaded[l].base_vertex;
+            m.ranges.swap(uploaded[l].ranges);
+            m.order.swap(uploaded[l].order);
+        }
+        k = coarse;
+    }
+}
+
+inline float Primitive::chordError() const {
+    if (tolerance > 0) { return tolerance; }
+    //sagitta of an arc of radius r cut into n chords per full turn
+    auto sagitta = [](float r, float n) { return r * (1.0f - cos(acos(-1.0f) / n)); };
+    float ring = 4.0f * (subd[0] + 1), reach = max(dim[0], dim[1]);
+    switch (sh) {
+        case ELLIPTICAL_PLANE:
+        case CYLINDER:
+        case CONE: { return sagitta(reach, ring); }
+        //2 (subd[1] + 1) rows from pole to pole, 4 (subd[1] + 1) chords per meridian
+        case ELLIPSOID: { return max(sagitta(reach, ring), sagitta(max(reach, dim[2]), 4.0f * (subd[1] + 1))); }
+        case TORUS: { return max(sagitta(reach + dim[2], ring), sagitta(dim[2], 4.0f * (subd[1] + 1))); }
+        default: { return 0.0f; }
+    }
+}
+
+inline void Primitive::fitTolerance(PrimitiveKey& k) {
+    if (k.tolerance <= 0 || k.sh == RECTANGULAR_PLANE || k.sh == CUBOID) {
+        k.tolerance = 0;
+        return;
+    }
+    double pi = acos(-1.0), e = k.tolerance / 2.0, step = sqrt(8 * e);
+    double a = k.dim[0], b = k.dim[1], c = k.dim[2];
+    if (k.sh == ELLIPTICAL_PLANE || k.sh == CYLINDER || k.sh == CONE) {
+        //a single ring, subd[1] is not used
+        double quarter = integrate([a, b](double t) { return ellipseDensity(a, b, t); }, 0.0, pi / 2);
+        k.subd[0] = max(0, int(ceil(quarter / sqrt(8 * k.tolerance))) - 1);
+    } else if (k.sh == ELLIPSOID) {
+        //quarter ring and half meridian, with 4 (subd[0] + 1) and 2 (subd[1] + 1) chords per full curve
+        double quarter = integrate([a, b](double t) { return ellipseDensity(a, b, t); }, 0.0, pi / 2);
+        double half = integrate([a, b, c](double t) { return max(ellipseDensity(a, c, t), ellipseDensity(b, c, t)); }, -pi / 2, 0.0);
+        k.subd[0] = max(0, int(ceil(quarter / step)) - 1);
+        k.subd[1] = max(0, int(ceil(half / step)) - 1);
+    } else {
+        double quarter = integrate([a, b, c](double t) { return ellipseDensity(a + c, b + c, t); }, 0.0, pi / 2);
+        //chords of angle 2 pi / n on the tube circle have a sagitta of c (1 - cos(pi / n))
+        double angle = acos(max(-1.0, min(1.0, 1.0 - e / c)));
+        k.subd[0] = max(0, int(ceil(quarter / step)) - 1);
+        k.subd[1] = max(0, int(ceil(pi / angle / 4)) - 1);
+    }
+}
+
+inline vector<double> Primitive::ellipsoidRows(float a, float b, float c, uint n) {
+    double pi = acos(-1.0);
+    //the ring axis that bends the meridian most, the lower half is mirrored so the equator stays exact
+    vector<double> lower = equidistribute([a, b, c](double t) { return max(ellipseDensity(a, c, t), ellipseDensity(b, c, t)); }, -pi / 2, 0.0, n / 2);
+    vector<double> rows(n + 1);
+    for (uint i = 0; i <= n / 2; i++) {
+        rows[i] = lower[i];
+        rows[n - i] = -lower[i];
+    }
+    return rows;
+}
+
+template <Shape S>
+inline void Primitive::generateShape(Uvmap uv) {
+    //a flat primitive keeps the indexed smooth mesh
+    bool indexed = smooth || flat;
+    switch (uv) {
+        case FACE: { indexed ? PrimitiveGen<S, FACE, true>::build(*this) : PrimitiveGen<S, FACE, false>::build(*this); break; }
+        case PROJECT: { indexed ? PrimitiveGen<S, PROJECT, true>::build(*this) : PrimitiveGen<S, PROJECT, false>::build(*this); break; }
+        case UNWRAP: { indexed ? PrimitiveGen<S, UNWRAP, true>::build(*this) : PrimitiveGen<S, UNWRAP, false>::build(*this); break; }
+        case NO_UVMAP: { indexed ? PrimitiveGen<S, NO_UVMAP, true>::build(*this) : PrimitiveGen<S, NO_UVMAP, false>::build(*this); break; }
+    }
+}
+
+inline void Primitive::genUvmap(Uvmap uv) {
+    //faceting changes the triangles, not only the vertex attributes
+    bool faceted = flat && (uv == FACE || uv == UNWRAP);
+    if (faceted) {
+        facet();
+        flat = false;
+    }
+    switch (sh) {
+        case RECTANGULAR_PLANE: { applyUvmap<RECTANGULAR_PLANE>(uv); break; }
+        case ELLIPTICAL_PLANE: { applyUvmap<ELLIPTICAL_PLANE>(uv); break; }
+        case CUBOID: { applyUvmap<CUBOID>(uv); break; }
+        case ELLIPSOID: { applyUvmap<ELLIPSOID>(uv); break; }
+        case CYLINDER: { applyUvmap<CYLINDER>(uv); break; }
+        case CONE: { applyUvmap<CONE>(uv); break; }
+        case TORUS: { applyUvmap<TORUS>(uv); break; }
+    }
+    if (lod_levels) { buildLods(uv); }
+    if (faceted) {
+        setupMesh();
+    } else {
+        updateVertices();
+    }
+}
+
+template <Shape S>
+inline void Primitive::applyUvmap(Uvmap uv) {
+    switch (uv) {
+        case FACE: { UvmapGen<S, FACE>::apply(*this); break; }
+        case PROJECT: { UvmapGen<S, PROJECT>::apply(*this); break; }
+        case UNWRAP: { UvmapGen<S, UNWRAP>::apply(*this); break; }
+        case NO_UVMAP: break;
+    }
+}
+
 #endif /* primitive_h */
@@ -0,0 +1,71 @@
+//
+//  renderqueue.h
+//  BasicOpenGL
+//
+
+#ifndef renderqueue_h
+#define renderqueue_h
+
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+//one object to draw, object is the position of the object in Scene::objects
+struct DrawItem {
+    uint64_t key;
+    unsigned int object;
+};
+
+//Draw order for a frame. Items are ordered by a 64 bit key that puts the most expensive state change
+//in the highest bits, so that sorting groups draws sharing a program, then a texture set, then a material:
+//  63..56 shader   55..40 texture set   39..24 material   23..0 depth (front to back)
+class RenderQueue {
+    typedef unsigned int uint;
+public:
+    static const uint DEPTH_BITS = 24;
+    vector<DrawItem> items;
+
+    //depth is expected in [0, 1], ids are truncated to the width of their field
+    static uint64_t makeKey(uint shader, uint texture_set, uint material, float depth) {
+        if (depth < 0.0f) { depth = 0.0f; }
+        if (depth > 1.0f) { depth = 1.0f; }
+        uint64_t d = uint64_t(depth * ((1u << DEPTH_BITS) - 1));
+        return (uint64_t(shader & 0xFF) << 56) | (uint64_t(texture_set & 0xFFFF) << 40) | (uint64_t(material & 0xFFFF) << 24) | d;
+    }
+    void clear() {
+        items.clear();
+    }
+    void push(uint64_t key, uint object) {
+        DrawItem item = {key, object};
+        items.push_back(item);
+    }
+    //least significant digit radix sort, one byte per pass. It is stable, and passes where
+    //every key has the same byte are skipped, so unused fields cost a single counting loop.
+    void sort() {
+        if (items.size() < 2) { return; }
+        scratch.resize(items.size());
+        for (uint shift = 0; shift < 64; shift += 8) {
+            size_t count[256] = {0};
+            for (size_t i = 0; i < items.size(); i++) {
+                count[(items[i].key >> shift) & 0xFF]++;
+            }
+            if (count[(items[0].key >> shift) & 0xFF] == items.size()) { continue; }
+            size_t offset = 0;
+            for (uint b = 0; b < 256; b++) {
+                size_t c = count[b];
+                count[b] = offset;
+                offset += c;
+            }
+            for (size_t i = 0; i < items.size(); i++) {
+                scratch[count[(items[i].key >> shift) & 0xFF]++] = items[i];
+            }
+            items.swap(scratch);
+        }
+    }
+
+private:
+    vector<DrawItem> scratch;
+};
+
+#endif /* renderqueue_h */
@@ -0,0 +1,181 @@
+//
+//  ring.h
+//  BasicOpenGL
+//
+
+#ifndef ring_h
+#define ring_h
+
+#include <mesh.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RING_SSE 1
+#endif
+
+using namespace std;
+
+enum Normal {ELLIPTICAL_PLANE_NORMAL, ELLIPSOID_NORMAL, CYLINDER_NORMAL, CONE_NORMAL, TORUS_NORMAL};
+
+//sqrt of the curvature of the ellipse (a cos t, b sin t) times its arc length element. A chord spanning
+//an integral s of it has a sagitta of about s^2 / 8, so chords with equal integrals have equal errors
+inline double ellipseDensity(double a, double b, double t) {
+    double s = sin(t), c = cos(t);
+    return sqrt(a * b) / pow(a * a * s * s + b * b * c * c, 0.25);
+}
+
+//integral of density over [t0, t1], trapezoids
+template <class Density>
+inline double integrate(Density density, double t0, double t1, unsigned int steps = 1024) {
+    double sum = 0.5 * (density(t0) + density(t1)), h = (t1 - t0) / steps;
+    for (unsigned int k = 1; k < steps; k++) { sum += density(t0 + k * h); }
+    return sum * h;
+}
+
+//n + 1 parameters from t0 to t1 that cut [t0, t1] into n pieces with equal integrals of density
+template <class Density>
+inline vector<double> equidistribute(Density density, double t0, double t1, unsigned int n) {
+    unsigned int steps = max(1024u, 16 * n);
+    double h = (t1 - t0) / steps;
+    vector<double> cumulative(steps + 1, 0.0), out(n + 1);
+    double previous = density(t0);
+    for (unsigned int k = 1; k <= steps; k++) {
+        double next = density(t0 + k * h);
+        cumulative[k] = cumulative[k - 1] + 0.5 * (previous + next) * h;
+        previous = next;
+    }
+    out[0] = t0;
+    out[n] = t1;
+    unsigned int k = 0;
+    for (unsigned int j = 1; j < n; j++) {
+        double target = cumulative[steps] * j / n;
+        while (cumulative[k + 1] < target) { k++; }
+        double span = cumulative[k + 1] - cumulative[k];
+        out[j] = t0 + h * (k + (span > 0 ? (target - cumulative[k]) / span : 0.0));
+    }
+    return out;
+}
+
+//cos and sin of the angles 2 pi i / n, i < n, of a ring with n vertices.
+//A table is built once per ring resolution and shared by every ring of a primitive.
+struct RingTable {
+    vector<float> cosines;
+    vector<float> sines;
+    explicit RingTable(unsigned int n = 0) {
+        double pi = acos(-1.0);
+        cosines.resize(n);
+        sines.resize(n);
+        for (unsigned int i = 0; i < n; i++) {
+            double theta = 2 * i * pi / n;
+            cosines[i] = float(cos(theta));
+            sines[i] = float(sin(theta));
+        }
+        //exact values on the axes, so the ring passes through (a, 0), (0, b), (-a, 0) and (0, -b)
+        if (n && n % 4 == 0) {
+            const float axis_cos[4] = {1, 0, -1, 0}, axis_sin[4] = {0, 1, 0, -1};
+            for (unsigned int q = 0; q < 4; q++) {
+                cosines[q * n / 4] = axis_cos[q];
+                sines[q * n / 4] = axis_sin[q];
+            }
+        }
+    }
+    //n vertices, a multiple of 4, spread along the ellipse with half axes a and b so that every chord has
+    //about the same sagitta: dense where the ellipse bends, sparse where it is flat. The table holds the
+    //directions of the points, emitRing puts them on rings of any size with the same proportions
+    RingTable(unsigned int n, double a, double b) : RingTable(n) {
+        if (!n || n % 4 || a <= 0 || b <= 0) { return; }
+        unsigned int m = n / 4;
+        vector<double> quarter = equidistribute([a, b](double t) { return ellipseDensity(a, b, t); }, 0.0, acos(-1.0) / 2, m);
+        //the other quadrants mirror the first, which keeps the points on the axes exact
+        const int sign_x[4] = {1, -1, -1, 1}, sign_y[4] = {1, 1, -1, -1};
+        for (unsigned int q = 0; q < 4; q++) {
+            for (unsigned int k = 0; k < m; k++) {
+                double t = quarter[q % 2 ? m - k : k];
+                double x = sign_x[q] * a * cos(t), y = sign_y[q] * b * sin(t), l = sqrt(x * x + y * y);
+                cosines[q * m + k] = float(x / l);
+                sines[q * m + k] = float(y / l);
+            }
+            cosines[q * m] = float(sign_x[q] * (q % 2 ? 0 : 1));
+            sines[q * m] = float(sign_y[q] * (q % 2 ? 1 : 0));
+        }
+    }
+    unsigned int size() const { return cosines.size(); }
+};
+
+//Writes the ring of n = table.size() vertices where the plane at height z cuts the ellipse with
+//half axes a and b to out. Vertex i lies at polar angle 2 pi i / n, at distance
+//r = ab / sqrt(b^2 cos^2 + a^2 sin^2) from the axis. Normals follow n:
+//  ELLIPSOID_NORMAL, CONE_NORMAL  the position, normalized
+//  CYLINDER_NORMAL                (0, 0, z), normalized
+//  ELLIPTICAL_PLANE_NORMAL        (0, 0, 1)
+//  TORUS_NORMAL                   from the same angle on the ellipse (ca, cb) at height 0, normalized
+//Only Position and Normal are written. The SSE path computes four vertices at a time and gives the same
+//floats as the scalar one.
+inline void emitRing(const RingTable& table, float a, float b, float z, Normal n, Vertex* out, float ca = 0, float cb = 0) {
+    unsigned int count = table.size(), i = 0;
+    const float* c = count ? &table.cosines[0] : NULL;
+    const float* s = count ? &table.sines[0] : NULL;
+    float ab = a * b, aa = a * a, bb = b * b, cab = ca * cb, caa = ca * ca, cbb = cb * cb;
+#ifdef RING_SSE
+    __m128 vab = _mm_set1_ps(ab), vaa = _mm_set1_ps(aa), vbb = _mm_set1_ps(bb);
+    __m128 vcab = _mm_set1_ps(cab), vcaa = _mm_set1_ps(caa), vcbb = _mm_set1_ps(cbb);
+    __m128 vz = _mm_set1_ps(z), zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4) {
+        __m128 vc = _mm_loadu_ps(c + i), vs = _mm_loadu_ps(s + i);
+        __m128 cc = _mm_mul_ps(vc, vc), ss = _mm_mul_ps(vs, vs);
+        //a degenerate ellipse gives 0 / 0, such points collapse onto the axis
+        __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vbb, cc), _mm_mul_ps(vaa, ss)));
+        __m128 r = _mm_and_ps(_mm_div_ps(vab, d), _mm_cmpgt_ps(d, zero));
+        __m128 x = _mm_mul_ps(r, vc), y = _mm_mul_ps(r, vs);
+        __m128 nx, ny, nz;
+        switch (n) {
+            case ELLIPSOID_NORMAL :
+            case CONE_NORMAL : { nx = x; ny = y; nz = vz; break; }
+            case CYLINDER_NORMAL : { nx = zero; ny = zero; nz = vz; break; }
+            case TORUS_NORMAL : {
+                __m128 cd = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(vcbb, cc), _mm_mul_ps(vcaa, ss)));
+                __m128 cr = _mm_and_ps(_mm_div_ps(vcab, cd), _mm_cmpgt_ps(cd, zero));
+                nx = _mm_sub_ps(x, _mm_mul_ps(cr, vc)); ny = _mm_sub_ps(y, _mm_mul_ps(cr, vs)); nz = vz;
+                break;
+            }
+            default : { nx = zero; ny = zero; nz = one; }
+        }
+        __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+        nx = _mm_div_ps(nx, len); ny = _mm_div_ps(ny, len); nz = _mm_div_ps(nz, len);
+        float px[4], py[4], qx[4], qy[4], qz[4];
+        _mm_storeu_ps(px, x); _mm_storeu_ps(py, y);
+        _mm_storeu_ps(qx, nx); _mm_storeu_ps(qy, ny); _mm_storeu_ps(qz, nz);
+        for (unsigned int k = 0; k < 4; k++) {
+            out[i + k].Position = glm::vec3(px[k], py[k], z);
+            out[i + k].Normal = glm::vec3(qx[k], qy[k], qz[k]);
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        float cc = c[i] * c[i], ss = s[i] * s[i];
+        float d = sqrtf(bb * cc + aa * ss);
+        float r = d > 0 ? ab / d : 0.0f;
+        float x = r * c[i], y = r * s[i];
+        float nx, ny, nz;
+        switch (n) {
+            case ELLIPSOID_NORMAL :
+            case CONE_NORMAL : { nx = x; ny = y; nz = z; break; }
+            case CYLINDER_NORMAL : { nx = 0.0f; ny = 0.0f; nz = z; break; }
+            case TORUS_NORMAL : {
+                float cd = sqrtf(cbb * cc + caa * ss);
+                float cr = cd > 0 ? cab / cd : 0.0f;
+                nx = x - cr * c[i]; ny = y - cr * s[i]; nz = z;
+                break;
+            }
+            default : { nx = 0.0f; ny = 0.0f; nz = 1.0f; }
+        }
+        float len = sqrtf(nx * nx + ny * ny + nz * nz);
+        out[i].Position = glm::vec3(x, y, z);
+        out[i].Normal = glm::vec3(nx / len, ny / len, nz / len);
+    }
+}
+
+#endif /* ring_h */
@@ -20,6 +20,13 @@
 #include <shader.h>
 #include <material.h>
 #include <texture.h>
+#include <slotmap.h>
+#include <renderqueue.h>
+#include <bvh.h>
+#include <indirect.h>
+#include <instancing.h>
+#include <geometry.h>
+#include <chrono>
 
 extern Camera CAMERA;
 extern const unsigned int SCR_WIDTH;
@@ -27,53 +34,296 @@ extern const unsigned int SCR_HEIGHT;
 
 enum LightType {POINTLIGHT, DIRECTEDLIGHT, SPOTLIGHT};
 
+//must match MAX_LIGHTS in the default shaders
+const unsigned int MAX_LIGHTS = 100;
+//near and far clipping planes of the projection
+const float Z_NEAR = 0.1f;
+const float Z_FAR = 100.0f;
+//an object keeps its level of detail until the level's error on screen is this fraction past the limit
+const float LOD_HYSTERESIS = 0.25f;
+//uniform buffer binding point of the LightBlock uniform block
+const unsigned int LIGHT_BLOCK_BINDING = 0;
+
+//std140 image of the Light struct declared in shaders/lighting.glsl
+struct LightData {
+    GLint ltype;
+    GLint pad0[3];
+    glm::vec3 position;
+    float pad1;
+    glm::vec3 direction;
+    float inner_cutoff;
+    float outer_cutoff;
+    float pad2[3];
+    glm::vec3 constants;
+    float pad3;
+    glm::vec3 ambient;
+    float pad4;
+    glm::vec3 diffuse;
+    float pad5;
+    glm::vec3 specular;
+    float pad6;
+};
+static_assert(sizeof(LightData) == 128, "LightData must follow the std140 layout of Light");
+
+//must match MAX_MATERIALS in shaders/lighting.glsl
+const unsigned int MAX_MATERIALS = 256;
+//uniform buffer binding point of the MaterialBlock uniform block
+const unsigned int MATERIAL_BLOCK_BINDING = 1;
+
+//std140 image of the Material struct declared in shaders/lighting.glsl
+struct MaterialData {
+    glm::vec3 ambient;
+    float pad0;
+    glm::vec3 diffuse;
+    float pad1;
+    glm::vec3 specular;
+    float shininess;
+};
+static_assert(sizeof(MaterialData) == 48, "MaterialData must follow the std140 layout of Material");
+
+//std140 image of the LightBlock uniform block
+struct LightBlock {
+    GLint nr_lights;
+    GLint pad[3];
+    LightData lights[MAX_LIGHTS];
+};
+
+//counters gathered while rendering the last frame
+struct RenderStats {
+    //uniforms resolved by name instead of through a cached location
+    unsigned int uniform_lookups;
+    //lights written to the light uniform buffer
+    unsigned int light_uploads;
+    //shaders that received a new camera position
+    unsigned int camera_uploads;
+    //state changes issued and state changes avoided by drawing in sorted order
+    unsigned int program_binds, program_binds_saved;
+    unsigned int texture_binds, texture_binds_saved;
+    unsigned int vertex_array_binds, vertex_array_binds_saved;
+    unsigned int material_uploads, material_uploads_saved;
+    //draw calls issued, how many of them were instanced and the instances they drew
+    unsigned int draw_calls, instanced_draws, instances;
+    //multi-draw calls issued and the draw commands they read, see setMultiDrawIndirect
+    unsigned int multi_draws, indirect_commands;
+    //objects tested against the view frustum, how many of them were drawn and skipped, and the bvh nodes
+    //visited, see setFrustumCulling
+    CullStats culling;
+    //triangles submitted, and how many full detail meshes would have submitted, see setLodLevels
+    unsigned int triangles, full_triangles;
+    //time spent in Scene::render on the CPU, in milliseconds
+    float cpu_time;
+};
+
+//locations of the uniforms an object sets on every draw, resolved once against its shader
+struct ObjectUniforms {
+    GLint view, projection, model, textured, light_idx, flat;
+    GLint quantized, position_offset, position_scale;
+    GLint ambient, diffuse, specular, shininess;
+    void locate(const Shader& sh) {
+        view = sh.location(uniformHash("view"));
+        projection = sh.location(uniformHash("projection"));
+        model = sh.location(uniformHash("model"));
+        textured = sh.location(uniformHash("textured"));
+        flat = sh.location(uniformHash("flat_shading"));
+        quantized = sh.location(uniformHash("quantized"));
+        position_offset = sh.location(uniformHash("position_offset"));
+        position_scale = sh.location(uniformHash("position_scale"));
+        light_idx = sh.location(uniformHash("light_idx"));
+        ambient = sh.location(uniformHash("material.ambient"));
+        diffuse = sh.location(uniformHash("material.diffuse"));
+        specular = sh.location(uniformHash("material.specular"));
+        shininess = sh.location(uniformHash("material.shininess"));
+    }
+    //tell the shader how to decode the vertices of mesh
+    void setMesh(const Shader& sh, const Mesh& mesh) const {
+        bool q = mesh.format & VERTEX_QUANTIZED;
+        sh.setBool(flat, mesh.flat);
+        sh.setBool(quantized, q);
+        if (q) {
+            sh.setVec3(position_offset, mesh.position_offset);
+            sh.setVec3(position_scale, mesh.position_scale);
+        }
+    }
+};
+
+//locations of the per frame uniforms of a shader and what they were last set to
+struct ShaderUniforms {
+    GLint camera_pos;
+    //CAMERA.Version last uploaded to this shader
+    unsigned int camera_version;
+    bool camera_uploaded;
+    void locate(const Shader& sh) {
+        camera_pos = sh.location(uniformHash("CameraPos"));
+        camera_uploaded = false;
+    }
+};
+
+//state shared by every draw of a frame, computed once at the start of Scene::render
+struct FrameContext {
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::mat4 view_projection;
+    glm::vec3 camera_position;
+    //left, right, bottom, top, near and far planes with inward facing normals,
+    //a point p is inside a plane when dot(vec3(plane), p) + plane.w >= 0
+    glm::vec4 frustum[6];
+    //pixels a length of 1 covers at distance 1 from the camera, for screen space sizes
+    float pixel_scale;
+    void begin(Camera& camera, float aspect) {
+        view = camera.GetViewMatrix();
+        projection = glm::perspective(glm::radians(camera.Zoom), aspect, Z_NEAR, Z_FAR);
+        view_projection = projection * view;
+        camera_position = camera.Position;
+        pixel_scale = SCR_HEIGHT / (2.0f * tan(glm::radians(camera.Zoom) / 2.0f));
+        //rows of the view projection matrix, glm stores matrices columnwise
+        glm::vec4 row[4];
+        for (uint i = 0; i < 4; i++) {
+            row[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+        }
+        for (uint i = 0; i < 3; i++) {
+            frustum[2 * i] = row[3] + row[i];
+            frustum[2 * i + 1] = row[3] - row[i];
+        }
+        for (uint i = 0; i < 6; i++) {
+            frustum[i] /= glm::length(glm::vec3(frustum[i]));
+        }
+        bound_program = 0;
+        matrices_set.clear();
+        materials_set.clear();
+        textures.reset();
+        program_binds = program_binds_saved = 0;
+        material_uploads = material_uploads_saved = 0;
+    }
+    //makes sh the current program unless it already is
+    void bind(const Shader& sh) {
+        if (bound_program != sh.ID) {
+            sh.use();
+            bound_program = sh.ID;
+            program_binds++;
+        } else {
+            program_binds_saved++;
+        }
+    }
+    //true unless material is already loaded into the uniforms of sh, the caller then uploads it
+    bool materialChanged(const Shader& sh, uint material) {
+        for (uint i = 0; i < materials_set.size(); i++) {
+            if (materials_set[i].first != sh.ID) { continue; }
+            if (materials_set[i].second == material) {
+                material_uploads_saved++;
+                return false;
+            }
+            materials_set[i].second = material;
+            material_uploads++;
+            return true;
+        }
+        materials_set.push_back(make_pair(sh.ID, material));
+        material_uploads++;
+        return true;
+    }
+    //true only the first time it is asked about sh in this frame, the caller then uploads view and projection
+    bool firstUse(const Shader& sh) {
+        if (find(matrices_set.begin(), matrices_set.end(), sh.ID) != matrices_set.end()) { return false; }
+        matrices_set.push_back(sh.ID);
+        return true;
+    }
+    TextureCache textures;
+    uint program_binds, program_binds_saved;
+    uint material_uploads, material_uploads_saved;
+private:
+    GLuint bound_program;
+    vector<GLuint> matrices_set;
+    //material currently loaded in each program
+    vector<pair<GLuint, uint> > materials_set;
+};
+
+//a shader program together with the scene's bookkeeping for it
+struct SceneShader {
+    Shader program;
+    ShaderUniforms uniforms;
+};
+
 class Object {
  public:
+    //batch and entry of an object that has none
+    static const uint NONE = ~0u;
     Object() {}
-    Object(Primitive* pm, glm::mat4& t, glm::mat4& r, glm::mat4& s, Material* mat, Shader* sh, bool tex, bool isl) :
-    base_mesh(pm), translate(t), rotate(r),  scale(s), material(mat), shader(sh), textured(tex), islight(isl) {}
-    void Draw() {
-        //create transform matrices
-        glm::mat4 view, projection, model;
-        view = CAMERA.GetViewMatrix();
-        projection = glm::perspective(glm::radians(CAMERA.Zoom), (float)SCR_WIDTH / SCR_HEIGHT, 0.1f, 100.0f);
+    Object(Primitive* pm, glm::mat4& t, glm::mat4& r, glm::mat4& s, uint mat, uint sh, const Shader& program, bool tex, bool isl) :
+    base_mesh(pm), translate(t), rotate(r),  scale(s), material(mat), shader(sh), textured(tex), islight(isl), dirty(true), lod(0), proxy(DynamicBvh::NONE), moved(false), stale(false), batch(NONE), entry(NONE) {
+        uniforms.locate(program);
+    }
+    //program and mat are what the shader and material handles currently resolve to
+    void Draw(FrameContext& frame, const Shader& program, const Material& mat, uint level = 0) {
+        frame.bind(program);
+        if (frame.firstUse(program)) {
+            program.setMat4(uniforms.view, frame.view);
+            program.setMat4(uniforms.projection, frame.projection);
+        }
+        program.setMat4(uniforms.model, getModel());
+        program.setBool(uniforms.textured, textured);
+        uniforms.setMesh(program, *base_mesh);
+        if (frame.materialChanged(program, material)) {
+            program.setVec3(uniforms.ambient, mat.ambient);
+            program.setVec3(uniforms.diffuse, mat.diffuse);
+            program.setVec3(uniforms.specular, mat.specular);
+            program.setFloat(uniforms.shininess, mat.shininess);
+        }
+        base_mesh->Draw(program, &frame.textures, level);
+    }
+    const glm::mat4& getModel() {
         //needs to be in reverse order since glm stores matrices columnwise
-        model = translate * rotate * scale;
-        shader->use();
-        shader->setMat4("view", view);
-        shader->setMat4("projection", projection);
-        shader->setMat4("model", model);
-        shader->setBool("textured", textured);
-        shader->setVec3("material.ambient", material->ambient);
-        shader->setVec3("material.diffuse", material->diffuse);
-        shader->setVec3("material.specular", material->specular);
-        shader->setFloat("material.shininess", material->shininess);
-        base_mesh->Draw(*shader);
+        if (dirty) {
+            model_matrix = translate * rotate * scale;
+            dirty = false;
+        }
+        return model_matrix;
     }
     Primitive* base_mesh;
     glm::mat4 translate;
     glm::mat4 rotate;
     glm::mat4 scale;
-    Material* material;
-    Shader* shader;
+    //handles into Scene::materials and Scene::shaders
+    uint material;
+    uint shader;
+    ObjectUniforms uniforms;
     bool textured;
     bool islight;
+    //set when translate, rotate or scale change so the model matrix is rebuilt
+    bool dirty;
+    //level of detail of base_mesh the object was last drawn with, see Scene::selectLod
+    uint lod;
+    //leaf of the object in Scene::bvh, and whether the object changed since the leaf was last refitted
+    uint proxy;
+    bool moved;
+    //set when the object moved since the last frame, its instance or draw data hold the old model matrix
+    bool stale;
+    //where the object's model matrix is drawn from: its instance in Scene::batches[batch], or with batch
+    //NONE its draw in Scene::indirect. entry is NONE when the object is drawn neither way this frame
+    uint batch;
+    uint entry;
+private:
+    glm::mat4 model_matrix;
 };
 
 class Light {
 public:
     Light() {}
-    Light(LightType l, Object* lobj, glm::vec3 pos, glm::vec3 dir, float incut, float outcut, glm::vec3 c, glm::vec3 amb, glm::vec3 diff, glm::vec3 spec) :
-    ltype(l), lightobject(lobj), position(pos), direction(dir), inner_cutoff(incut), outer_cutoff(outcut), constants(c), ambient(amb), diffuse(diff), specular(spec) {}
-    void Draw() {
-        //bool tmp = lightobject->renderable;
-        //lightobject->renderable = true;
-        lightobject->Draw();
-        //lightobject->renderable = tmp;
+    Light(LightType l, uint lobj, glm::vec3 pos, glm::vec3 dir, float incut, float outcut, glm::vec3 c, glm::vec3 amb, glm::vec3 diff, glm::vec3 spec) :
+    ltype(l), lightobject(lobj), position(pos), direction(dir), inner_cutoff(incut), outer_cutoff(outcut), constants(c), ambient(amb), diffuse(diff), specular(spec), dirty(true) {}
+    void pack(LightData& data) const {
+        data.ltype = int(ltype);
+        data.position = position;
+        data.direction = direction;
+        data.inner_cutoff = inner_cutoff;
+        data.outer_cutoff = outer_cutoff;
+        data.constants = constants;
+        data.ambient = ambient;
+        data.diffuse = diffuse;
+        data.specular = specular;
     }
     LightType ltype;
     
-    Object* lightobject;
+    //handle into Scene::objects of the object drawn for this light
+    uint lightobject;
     
     glm::vec3 position;
     glm::vec3 direction;
@@ -88,29 +338,66 @@ public:
     glm::vec3 ambient;
     glm::vec3 diffuse;
     glm::vec3 specular;
+    
+    //set when any of the above changes so the light is written to the uniform buffer again
+    bool dirty;
 };
 
 class Scene {
     typedef unsigned int uint;
 public:
-    map<uint, Light> lights;
-    map<uint, Object> objects;
-    map<uint, Material> materials;
-    map<uint, Shader> shaders;
+    //ids handed out by the create functions are handles into these, an id stays valid until
+    //its item is deleted and never refers to a different item afterwards
+    SlotMap<Light> lights;
+    SlotMap<Object> objects;
+    SlotMap<Material> materials;
+    SlotMap<SceneShader> shaders;
     vector<uint> textures;
+    //meshes of the objects, objects with the same primitive share one
+    GeometryCache geometry;
+    RenderStats stats;
     const static pair<string, string> default_obj_shader;
     const static pair<string, string> default_light_shader;
+    const static pair<string, string> default_instanced_shader;
+    const static pair<string, string> default_indirect_shader;
     const static glm::vec3 def;
-    Scene() {
+    Scene() : instancing(true), multi_draw(false), indirect_shader(SlotMap<SceneShader>::INVALID), frustum_culling(true), version(1), lights_dirty(true), lights_relaid(true), queue_version(0), queue_camera(0), materials_dirty(true) {
         dim[0] = dim[1] = dim[2] = 1.0;
         subd[0] = subd[1] = 5;
         smooth = false;
+        flat_shading = false;
+        vertex_format = PRIMITIVE_FORMAT;
+        optimize_meshes = false;
+        triangle_strips = false;
+        lod_levels = 0;
+        lod_error = 1.0f;
+        tessellation_tolerance = 0.0f;
         //default shader and material
-        createShader(default_obj_shader.first, default_obj_shader.second);
+        obj_shader = createShader(default_obj_shader.first, default_obj_shader.second);
         createShader(default_light_shader.first, default_light_shader.second);
+        instanced_shader = createShader(default_instanced_shader.first, default_instanced_shader.second);
+        instanced_uniforms.locate(shaders.get(instanced_shader)->program);
         createMaterial(CHROME);
+        //light uniform buffer shared by all shaders
+        glGenBuffers(1, &light_ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, light_ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(LightBlock), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, LIGHT_BLOCK_BINDING, light_ubo);
+        //material uniform buffer read by the instanced shader
+        glGenBuffers(1, &material_ubo);
+        glBindBuffer(GL_UNIFORM_BUFFER, material_ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(material_block), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, material_ubo);
     }
     ~Scene() {
+        glDeleteBuffers(1, &light_ubo);
+        glDeleteBuffers(1, &material_ubo);
+        releaseBatches();
+        geometry.clear();
+        GeometryArena::shared().trim();
+        indirect.release();
         lights.clear();
         objects.clear();
         materials.clear();
@@ -125,6 +412,41 @@ public:
     void setSmooth(bool sm) {
         smooth = sm;
     }
+    //objects created while smooth is off share the vertices of the smooth mesh and get their face normals
+    //in the fragment shader, instead of a copy of every vertex for each triangle using it
+    void setFlatShading(bool val) {
+        flat_shading = val;
+    }
+    //attributes the meshes of objects created from now on upload, see vertexformat.h. Objects that get
+    //textured have texture coordinates added to their format
+    void setVertexFormat(uint format) {
+        vertex_format = format | VERTEX_POSITION;
+    }
+    //upload the meshes of objects created from now on in an order tuned for the vertex cache and
+    //overdraw, see meshopt.h. Each mesh's Mesh::optimizationReport tells what it gained
+    void setOptimizeMeshes(bool val) {
+        optimize_meshes = val;
+    }
+    //draw the lateral grids of smooth and flat shaded ellipsoids, cylinders and tori of objects created
+    //from now on as triangle strips, caps stay triangle lists
+    void setTriangleStrips(bool val) {
+        triangle_strips = val;
+    }
+    //build up to n coarser levels of detail, each with half the subdivisions of the one before, into the
+    //buffers of the meshes of objects created from now on. Every frame an object is drawn at the coarsest
+    //level whose error stays within setLodError pixels on screen
+    void setLodLevels(uint n) {
+        lod_levels = n;
+    }
+    void setLodError(float pixels) {
+        lod_error = pixels;
+        version++;
+    }
+    //curved primitives of objects created from now on pick their subdivisions and place their vertices
+    //by curvature, to lie within tolerance model units of the exact surface. 0 goes back to setSubd
+    void setTessellationTolerance(float tolerance) {
+        tessellation_tolerance = tolerance;
+    }
     void setLightCutoff(int incut, int outcut) {
         light_inner_cutoff = incut;
         light_outer_cutoff = outcut;
@@ -144,6 +466,71 @@ public:
     void setRenderLights(bool val) {
         render_lights = val;
     }
+    //draw untextured objects that use the default object shader and share a primitive definition
+    //(shape, smooth, dim and subd) with a single instanced draw call
+    void setInstancing(bool val) {
+        instancing = val;
+        version++;
+    }
+    //skip objects whose bounds lie outside the view frustum, light objects are always drawn
+    void setFrustumCulling(bool val) {
+        frustum_culling = val;
+        version++;
+    }
+    //draw the untextured objects with the default object shader that are not instanced with a few
+    //glMultiDrawElementsIndirect calls, see indirect.h. Needs a GL 4.3 context, loader fetches the entry
+    //point the first time. Returns whether the objects are drawn that way, else they are drawn one by one
+    bool setMultiDrawIndirect(bool val, GLADloadproc loader = NULL) {
+        if (val && !indirect.available() && loader) { indirect.load(loader); }
+        multi_draw = val && indirect.available();
+        if (multi_draw && !shaders.get(indirect_shader)) {
+            indirect_shader = createShader(default_indirect_shader.first, default_indirect_shader.second);
+            indirect_uniforms.locate(shaders.get(indirect_shader)->program);
+        }
+        version++;
+        return multi_draw;
+    }
+    //per light setters, these only mark the modified light for upload
+    void setLightPosition(uint lightid, glm::vec3 pos) {
+        if (Light* light = touchLight(lightid)) { light->position = pos; }
+    }
+    void setLightDirection(uint lightid, glm::vec3 dir) {
+        if (Light* light = touchLight(lightid)) { light->direction = dir; }
+    }
+    void setLightCutoff(uint lightid, float incut, float outcut) {
+        if (Light* light = touchLight(lightid)) {
+            light->inner_cutoff = incut;
+            light->outer_cutoff = outcut;
+        }
+    }
+    void setLightConstants(uint lightid, glm::vec3 c) {
+        if (Light* light = touchLight(lightid)) { light->constants = c; }
+    }
+    void setLightAmbient(uint lightid, glm::vec3 amb) {
+        if (Light* light = touchLight(lightid)) { light->ambient = amb; }
+    }
+    void setLightDiffuse(uint lightid, glm::vec3 diff) {
+        if (Light* light = touchLight(lightid)) { light->diffuse = diff; }
+    }
+    void setLightSpecular(uint lightid, glm::vec3 spec) {
+        if (Light* light = touchLight(lightid)) { light->specular = spec; }
+    }
+    //object transforms, these only mark the modified object
+    void setTranslate(uint obj, glm::vec3 t) {
+        if (Object* object = moveObject(obj)) { object->translate = glm::translate(glm::mat4(), t); }
+    }
+    void setRotate(uint obj, glm::vec3 r, float deg) {
+        if (Object* object = moveObject(obj)) { object->rotate = glm::rotate(glm::mat4(), glm::radians(deg), r); }
+    }
+    void setScale(uint obj, glm::vec3 s) {
+        if (Object* object = moveObject(obj)) { object->scale = glm::scale(glm::mat4(), s); }
+    }
+    //incremented when objects, lights, materials or shaders are created or deleted, and when an object's
+    //mesh, material or texture or a draw setting changes. Moving an object or changing a light does not
+    //change it, render then only updates what moved
+    unsigned long getVersion() const {
+        return version;
+    }
     /*
     void scatter(Shape s, int n, int axes = 3, float scale_jitter = 0, float rotate_jitter = 0, int shaderid = 0, int materialid = 0) {
         for (uint i = 0; i < n; i++) {
@@ -152,32 +539,51 @@ public:
         }
     }
      */
+    //returns SlotMap<Object>::INVALID if the shader or material does not exist
     uint createObject(Shape sh, glm::vec3 t = def, glm::vec3 r = def, glm::vec3 s = def, float deg = 0, bool isl = false, uint shaderid = 0, uint materialid = 0) {
-        uint objectid = objects.size() ? objects.rbegin()->first + 1 : 0;
-        Primitive* primitive = new Primitive(sh, smooth, dim[0], dim[1], dim[2], subd[0], subd[1]);
+        const SceneShader* shader = shaders.get(shaderid);
+        if (!shader || !materials.contains(materialid)) {
+            cerr << "createObject: no shader " << shaderid << " or material " << materialid << endl;
+            return SlotMap<Object>::INVALID;
+        }
+        PrimitiveKey key = Primitive::makeKey(sh, smooth, dim[0], dim[1], dim[2], subd[0], subd[1]);
+        key.flat = flat_shading && !smooth;
+        key.format = vertex_format;
+        key.optimize = optimize_meshes;
+        key.strips = triangle_strips;
+        key.lods = lod_levels;
+        key.tolerance = tessellation_tolerance;
+        //keys of equal meshes compare equal in the geometry cache
+        Primitive::fitTolerance(key);
+        Primitive* primitive = geometry.acquire(key);
         glm::mat4 identity;
         glm::mat4 translate = glm::translate(identity, t);
         glm::mat4 rotate = glm::rotate(identity, glm::radians(deg), r);
         glm::mat4 scale = glm::scale(identity, s);
-        Shader* shader = &(shaders[shaderid]);
-        Material* material = &(materials[materialid]);
-        objects[objectid] = Object(primitive, translate, rotate, scale, material, shader, false, isl);
+        uint objectid = objects.insert(Object(primitive, translate, rotate, scale, materialid, shaderid, shader->program, false, isl));
+        placeObject(objectid, *objects.get(objectid));
+        version++;
         return objectid;
     }
+    //the light is drawn with object objid when lights are rendered, if that object exists
     uint createLight(LightType ltype, uint objid, glm::vec3 pos = def, glm::vec3 dir = def) {
-        uint lightid = lights.size() ? lights.rbegin()->first + 1 : 0;
-        lights[lightid] = Light(ltype, &objects[objid], pos, dir, light_inner_cutoff, light_outer_cutoff, light_constants, light_ambient, light_diffuse, light_specular);
+        uint lightid = lights.insert(Light(ltype, objid, pos, dir, light_inner_cutoff, light_outer_cutoff, light_constants, light_ambient, light_diffuse, light_specular));
+        lights_relaid = true;
+        version++;
         return lightid;
     }
     uint createMaterial(glm::vec3 amb, glm::vec3 diff, glm::vec3 spec, float s) {
-        uint materialid = materials.size() ? materials.rbegin()->first + 1 : 0;
-        materials[materialid] = Material(amb, diff, spec, s);
-        return materialid;
+        materials_dirty = true;
+        version++;
+        return materials.insert(Material(amb, diff, spec, s));
     }
     uint createShader(string vs, string fs) {
-        uint shaderid = shaders.size() ? shaders.rbegin()->first + 1 : 0;
-        shaders[shaderid] = Shader(vs.c_str(), fs.c_str());
-        return shaderid;
+        SceneShader shader;
+        shader.program = Shader(vs.c_str(), fs.c_str());
+        shader.program.bindBlock("LightBlock", LIGHT_BLOCK_BINDING);
+        shader.program.bindBlock("MaterialBlock", MATERIAL_BLOCK_BINDING);
+        shader.uniforms.locate(shader.program);
+        return shaders.insert(shader);
     }
     uint createTexture(string path) {
         uint textureid = loadTexture(path.c_str());
@@ -185,74 +591,549 @@ public:
         return textureid;
     }
     void setTexture(TEXTURETYPE textype, uint obj, uint texid) {
+        Object* object = touchObject(obj);
+        if (!object) { return; }
+        swapMesh(*object, geometry.modify(object->base_mesh));
+        if (!(object->base_mesh->format & VERTEX_UV)) {
+            object->base_mesh->setFormat(object->base_mesh->format | VERTEX_UV);
+        }
         switch (textype) {
-            case DIFFUSE : {objects[obj].base_mesh->addTexture(texid, "texture_diffuse"); break;}
-            case SPECULAR : {objects[obj].base_mesh->addTexture(texid, "texture_specular"); break;}
-            case EMISSION : {objects[obj].base_mesh->addTexture(texid, "texture_emission"); break;}
-            case NORMAL : {objects[obj].base_mesh->addTexture(texid, "texture_normal"); break;}
-            case HEIGHT : {objects[obj].base_mesh->addTexture(texid, "texture_height"); break;}
+            case DIFFUSE : {object->base_mesh->addTexture(texid, "texture_diffuse"); break;}
+            case SPECULAR : {object->base_mesh->addTexture(texid, "texture_specular"); break;}
+            case EMISSION : {object->base_mesh->addTexture(texid, "texture_emission"); break;}
+            case NORMAL : {object->base_mesh->addTexture(texid, "texture_normal"); break;}
+            case HEIGHT : {object->base_mesh->addTexture(texid, "texture_height"); break;}
         }
-        objects[obj].textured = true;
+        object->textured = true;
     }
     void setUvmap(uint obj, Uvmap m) {
-        objects[obj].base_mesh->genUvmap(m);
+        if (Object* object = touchObject(obj)) { swapMesh(*object, geometry.setUvmap(object->base_mesh, m)); }
     }
     void setMaterial(uint obj, uint materialid) {
-        objects[obj].material = &materials[materialid];
+        if (!materials.contains(materialid)) {
+            cerr << "setMaterial: no material " << materialid << endl;
+            return;
+        }
+        if (Object* object = touchObject(obj)) { object->material = materialid; }
     }
     void deleteLight(uint lightid) {
-        lights.erase(lightid);
+        //the last light moves into the freed slot of the uniform buffer
+        if (lights.erase(lightid)) {
+            lights_relaid = true;
+            version++;
+        }
     }
+    //the object's mesh is freed with its last user
     void deleteObject(uint objectid) {
+        Object* object = objects.get(objectid);
+        if (!object) { return; }
+        if (geometry.release(object->base_mesh)) {
+            //a batch may still point at the freed mesh
+            releaseBatches();
+        }
+        bvh.remove(object->proxy);
         objects.erase(objectid);
+        version++;
     }
     void deleteMaterial(uint materialid) {
-        materials.erase(materialid);
+        if (materials.erase(materialid)) {
+            materials_dirty = true;
+            version++;
+        }
     }
+    //the default object shader, which decides what goes into the batches, and the instanced and indirect
+    //shaders that draw them stay as long as the scene
     void deleteShader(uint shaderid) {
+        if (shaderid == obj_shader || shaderid == instanced_shader || shaderid == indirect_shader) {
+            cerr << "deleteShader: shader " << shaderid << " is built in" << endl;
+            return;
+        }
         shaders.erase(shaderid);
     }
     void deleteTexture(uint textureid) {
         glDeleteTextures(1, &textureid);
     }
+    //how full and how fragmented the buffers the meshes are suballocated from are, see arena.h
+    ArenaStats geometryStats() const {
+        return GeometryArena::shared().stats();
+    }
+    //handles of the objects whose world space boxes overlap the box [lo, hi], see bvh.h
+    vector<uint> objectsInBox(glm::vec3 lo, glm::vec3 hi) {
+        vector<uint> found;
+        refitObjects();
+        bvh.queryBox(lo, hi, found);
+        return found;
+    }
+    //handles of the objects whose world space boxes come within radius of center
+    vector<uint> objectsInRadius(glm::vec3 center, float radius) {
+        vector<uint> found;
+        refitObjects();
+        bvh.querySphere(center, radius, found);
+        return found;
+    }
+    //handles of the k objects whose world space boxes are nearest to point, nearest first
+    vector<uint> nearestObjects(glm::vec3 point, uint k) {
+        vector<uint> found;
+        refitObjects();
+        bvh.queryNearest(point, k, found);
+        return found;
+    }
+    //handles of the objects the camera sees, whether or not frustum culling is on
+    vector<uint> objectsInView() {
+        vector<uint> found;
+        FrameContext view;
+        view.begin(CAMERA, (float)SCR_WIDTH / SCR_HEIGHT);
+        refitObjects();
+        bvh.queryFrustum(view.frustum, found);
+        return found;
+    }
+    //how deep and how tight the tree over the objects is
+    BvhStats bvhStats() {
+        refitObjects();
+        return bvh.stats();
+    }
+    //close the holes deleted meshes left in those buffers, returns the bytes moved
+    size_t compactGeometry() {
+        //the indirect draw commands hold the meshes' places in the arena
+        version++;
+        return GeometryArena::shared().compact();
+    }
     void render() {
-        //bind global variables to all shaders
+        chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+        uint lookups = Shader::nameLookups();
+        stats.light_uploads = stats.camera_uploads = 0;
+        stats.draw_calls = stats.instanced_draws = stats.instances = 0;
+        stats.multi_draws = stats.indirect_commands = 0;
+        stats.triangles = stats.full_triangles = 0;
+        frame.begin(CAMERA, (float)SCR_WIDTH / SCR_HEIGHT);
+        //every shader reads the lights from the same uniform buffer, only changed lights are written
+        if (lights_dirty || lights_relaid) {
+            uploadLights();
+        }
+        if (materials_dirty) {
+            uploadMaterials();
+        }
+        //bind global variables to the shaders that have not seen the current camera
         for (auto it = shaders.begin(); it != shaders.end(); it++) {
-            it->second.use();
-            it->second.setVec3("CameraPos", CAMERA.Position);
-            it->second.setInt("nr_lights", lights.size());
-            uint i = 0;
-            for (auto it2 = lights.begin(); it2 != lights.end(); it2++) {
-                //send light's data as uniform to the new_shader
-                it->second.setInt("lights[" + to_string(i) + "].ltype", int(it2->second.ltype));
-                it->second.setVec3("lights[" + to_string(i) + "].position", it2->second.position);
-                it->second.setVec3("lights[" + to_string(i) + "].direction", it2->second.direction);
-                it->second.setFloat("lights[" + to_string(i) + "].inner_cutoff", it2->second.inner_cutoff);
-                it->second.setFloat("lights[" + to_string(i) + "].outer_cutoff", it2->second.outer_cutoff);
-                it->second.setVec3("lights[" + to_string(i) + "].constants", it2->second.constants);
-                it->second.setVec3("lights[" + to_string(i) + "].ambient", it2->second.ambient);
-                it->second.setVec3("lights[" + to_string(i) + "].diffuse", it2->second.diffuse);
-                it->second.setVec3("lights[" + to_string(i) + "].specular", it2->second.specular);
-                i++;
+            ShaderUniforms& u = it->uniforms;
+            if (u.camera_uploaded && u.camera_version == CAMERA.Version) { continue; }
+            frame.bind(it->program);
+            it->program.setVec3(u.camera_pos, frame.camera_position);
+            u.camera_version = CAMERA.Version;
+            u.camera_uploaded = true;
+            stats.camera_uploads++;
+        }
+        //draw in state order, the order only changes when the scene or the camera does
+        bool structural = queue_version != version, camera = queue_camera != CAMERA.Version;
+        if (structural) {
+            buildBatches();
+        }
+        if (structural || camera || !stale_objects.empty()) {
+            refitObjects();
+            //objects that came into view or left it change the indirect commands as well. When only
+            //objects moved, only they can have
+            bool changed = (structural || camera ? cullObjects() : cullStale()) || structural;
+            buildIndirect(changed);
+            selectInstances(changed);
+            //rebuilt draw lists have the new matrices already, else they go in place. Moved objects keep
+            //their place in the queue until the camera moves
+            writeStale(!changed);
+            if (changed || camera) {
+                buildQueue();
             }
         }
-        for (auto it = objects.begin(); it != objects.end(); it++) {
-            if (!it->second.islight) {it->second.Draw();}
+        stats.culling = cull_stats;
+        for (uint i = 0; i < queue.items.size(); i++) {
+            drawObject(objects.at(queue.items[i].object));
+        }
+        if (!batches.empty()) {
+            const Shader& program = shaders.get(instanced_shader)->program;
+            frame.bind(program);
+            if (frame.firstUse(program)) {
+                program.setMat4(instanced_uniforms.view, frame.view);
+                program.setMat4(instanced_uniforms.projection, frame.projection);
+            }
+            for (uint i = 0; i < batches.size(); i++) {
+                if (batches[i].instances.empty()) { continue; }
+                instanced_uniforms.setMesh(program, *batches[i].mesh);
+                uint draws = batches[i].Draw();
+                stats.draw_calls += draws;
+                stats.instanced_draws += draws;
+                stats.instances += batches[i].instances.size();
+                stats.triangles += batches[i].triangles();
+                stats.full_triangles += batches[i].instances.size() * batches[i].mesh->triangles();
+            }
+            //batches bind vertex arrays of their own and leave none bound
+            frame.textures.vertex_array = 0;
+        }
+        if (indirect.draws) {
+            const Shader& program = shaders.get(indirect_shader)->program;
+            frame.bind(program);
+            if (frame.firstUse(program)) {
+                program.setMat4(indirect_uniforms.view, frame.view);
+                program.setMat4(indirect_uniforms.projection, frame.projection);
+            }
+            uint calls = indirect.Draw();
+            stats.draw_calls += calls;
+            stats.multi_draws += calls;
+            stats.indirect_commands += indirect.commands();
+            stats.triangles += indirect.triangles;
+            stats.full_triangles += indirect_full_triangles;
+            frame.textures.vertex_array = 0;
         }
         if (render_lights) {
-            uint i = 0;
-            for (auto it = lights.begin(); it != lights.end(); it++) {
-                it->second.lightobject->shader->setInt("light_idx", i);
-                it->second.Draw();
-                i++;
+            //light_idx is the light's slot in the light uniform buffer
+            for (uint i = 0; i < lights.size(); i++) {
+                Object* lobj = objects.get(lights.at(i).lightobject);
+                const SceneShader* shader = lobj ? shaders.get(lobj->shader) : NULL;
+                if (!shader) { continue; }
+                frame.bind(shader->program);
+                shader->program.setInt(lobj->uniforms.light_idx, i);
+                drawObject(*lobj);
             }
         }
+        stats.uniform_lookups = Shader::nameLookups() - lookups;
+        stats.program_binds = frame.program_binds;
+        stats.program_binds_saved = frame.program_binds_saved;
+        stats.texture_binds = frame.textures.binds;
+        stats.texture_binds_saved = frame.textures.skipped;
+        stats.vertex_array_binds = frame.textures.array_binds;
+        stats.vertex_array_binds_saved = frame.textures.arrays_skipped;
+        //objects leave their vertex array bound for the next one
+        glBindVertexArray(0);
+        stats.material_uploads = frame.material_uploads;
+        stats.material_uploads_saved = frame.material_uploads_saved;
+        stats.cpu_time = chrono::duration<float, milli>(chrono::high_resolution_clock::now() - start).count();
     }
     
 private:
+    //resolve a handle that is about to be modified and mark it dirty, NULL if it does not exist
+    Light* touchLight(uint lightid) {
+        Light* light = lights.get(lightid);
+        if (!light) {
+            cerr << "no light " << lightid << endl;
+            return NULL;
+        }
+        light->dirty = true;
+        lights_dirty = true;
+        return light;
+    }
+    Object* touchObject(uint obj) {
+        Object* object = moveObject(obj);
+        if (object) { version++; }
+        return object;
+    }
+    //the same for a change of transform only, which leaves the batches, draw lists and queue as they are.
+    //render refits the object's leaf and writes its new model matrix where it is drawn from
+    Object* moveObject(uint obj) {
+        Object* object = objects.get(obj);
+        if (!object) {
+            cerr << "no object " << obj << endl;
+            return NULL;
+        }
+        object->dirty = true;
+        if (!object->moved) {
+            object->moved = true;
+            moved_objects.push_back(obj);
+        }
+        if (!object->stale) {
+            object->stale = true;
+            stale_objects.push_back(obj);
+        }
+        return object;
+    }
+    //the mesh object used may have been freed by the cache, and a batch may still point at it
+    void swapMesh(Object& object, Primitive* mesh) {
+        if (mesh == object.base_mesh) { return; }
+        object.base_mesh = mesh;
+        releaseBatches();
+    }
+    //objects whose shader or material has been deleted are skipped
+    void drawObject(Object& object) {
+        const SceneShader* shader = shaders.get(object.shader);
+        const Material* material = materials.get(object.material);
+        if (shader && material) {
+            uint level = selectLod(object);
+            object.Draw(frame, shader->program, *material, level);
+            stats.draw_calls++;
+            stats.triangles += object.base_mesh->triangles(level);
+            stats.full_triangles += object.base_mesh->triangles();
+        }
+    }
+    //the level of detail to draw object at this frame: the coarsest level whose error, projected at the
+    //point of the object's bounding sphere nearest to the camera, stays within lod_error pixels. The
+    //object keeps its last level while that is within LOD_HYSTERESIS of the limit, so objects close to a
+    //switching distance do not pop back and forth
+    uint selectLod(Object& object) {
+        const Mesh& mesh = *object.base_mesh;
+        if (mesh.levels() == 1) { return object.lod = 0; }
+        const glm::mat4& model = object.getModel();
+        float scale = max(glm::length(glm::vec3(model[0])), max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        glm::vec3 center = glm::vec3(model * glm::vec4(mesh.center, 1.0f));
+        float distance = glm::length(center - frame.camera_position) - mesh.radius * scale;
+        if (distance <= Z_NEAR) { return object.lod = 0; }
+        //pixels per model space unit
+        float pixels = scale * frame.pixel_scale / distance;
+        auto coarsest = [&](float limit) {
+            uint level = 0;
+            while (level + 1 < mesh.levels() && mesh.lods[level].error * pixels <= limit) { level++; }
+            return level;
+        };
+        uint finest = coarsest(lod_error * (1.0f - LOD_HYSTERESIS)), coarse = coarsest(lod_error * (1.0f + LOD_HYSTERESIS));
+        object.lod = min(max(object.lod, finest), coarse);
+        return object.lod;
+    }
+    //objects that can be drawn by the instanced shader, see setInstancing
+    bool instanceable(const Object& object) const {
+        return instancing && object.shader == obj_shader && !object.textured && (object.material & SlotMap<Material>::INDEX_MASK) < MAX_MATERIALS;
+    }
+    //objects that can be drawn by the indirect shader, see setMultiDrawIndirect
+    bool multiDrawable(const Object& object) const {
+        return multi_draw && object.shader == obj_shader && !object.textured && (object.material & SlotMap<Material>::INDEX_MASK) < MAX_MATERIALS && object.base_mesh->arenaAllocation();
+    }
+    //gather objects sharing a primitive definition into instance batches, the objects that are not
+    //lights and not instanced are left in indirect_objects if they can be drawn indirectly, else in queued
+    void buildBatches() {
+        queued.clear();
+        indirect_objects.clear();
+        map<PrimitiveKey, vector<uint> > groups;
+        for (uint i = 0; i < objects.size(); i++) {
+            Object& object = objects.at(i);
+            object.batch = object.entry = Object::NONE;
+            if (object.islight) { continue; }
+            if (instanceable(object)) {
+                groups[object.base_mesh->key()].push_back(i);
+            } else {
+                (multiDrawable(object) ? indirect_objects : queued).push_back(i);
+            }
+        }
+        uint used = 0;
+        for (auto it = groups.begin(); it != groups.end(); it++) {
+            if (it->second.size() < 2) {
+                (multiDrawable(objects.at(it->second[0])) ? indirect_objects : queued).push_back(it->second[0]);
+                continue;
+            }
+            if (used == batches.size()) { batches.push_back(InstanceBatch()); }
+            InstanceBatch& batch = batches[used++];
+            batch.setMesh(objects.at(it->second[0]).base_mesh);
+            batch.objects = it->second;
+        }
+        for (uint i = used; i < batches.size(); i++) {
+            batches[i].release();
+        }
+        batches.resize(used);
+    }
+    //fill the instances of every batch with its objects in view, ordered by the level of detail each is
+    //drawn at when the mesh has levels. Unless the scene or what is in view changed, only batches with
+    //levels are filled again
+    void selectInstances(bool changed) {
+        for (uint i = 0; i < batches.size(); i++) {
+            InstanceBatch& batch = batches[i];
+            uint levels = batch.mesh->levels();
+            if (!changed && levels == 1) { continue; }
+            vector<uint> drawn, level;
+            batch.level_first.assign(levels + 1, 0);
+            for (uint j = 0; j < batch.objects.size(); j++) {
+                if (!in_view[batch.objects[j]]) {
+                    objects.at(batch.objects[j]).entry = Object::NONE;
+                    continue;
+                }
+                drawn.push_back(batch.objects[j]);
+                level.push_back(levels > 1 ? selectLod(objects.at(batch.objects[j])) : 0);
+                batch.level_first[level.back() + 1]++;
+            }
+            for (uint l = 0; l < levels; l++) {
+                batch.level_first[l + 1] += batch.level_first[l];
+            }
+            vector<uint> next(batch.level_first.begin(), batch.level_first.end() - 1);
+            batch.instances.resize(drawn.size());
+            for (uint j = 0; j < drawn.size(); j++) {
+                Object& object = objects.at(drawn[j]);
+                object.batch = i;
+                object.entry = next[level[j]]++;
+                InstanceData& instance = batch.instances[object.entry];
+                instance.model = object.getModel();
+                instance.material = object.material & SlotMap<Material>::INDEX_MASK;
+            }
+            if (levels == 1) { batch.level_first.clear(); }
+            batch.upload();
+        }
+    }
+    //put the world space box of object, whose handle is handle, into the bvh, or refit its leaf
+    void placeObject(uint handle, Object& object) {
+        const Mesh& mesh = *object.base_mesh;
+        glm::vec3 lo, hi;
+        transformBox(object.getModel(), mesh.box_min, mesh.box_max, lo, hi);
+        if (object.proxy == DynamicBvh::NONE) {
+            object.proxy = bvh.insert(handle, lo, hi);
+        } else {
+            bvh.move(object.proxy, lo, hi);
+        }
+        object.moved = false;
+    }
+    //refit the leaves of the objects changed since the last refit, deleted ones are skipped
+    void refitObjects() {
+        for (uint i = 0; i < moved_objects.size(); i++) {
+            Object* object = objects.get(moved_objects[i]);
+            if (object && object->moved) { placeObject(moved_objects[i], *object); }
+        }
+        moved_objects.clear();
+    }
+    //mark the objects in view in in_view, returns whether any object came into view or left it. Light
+    //objects are tested too but drawn regardless
+    bool cullObjects() {
+        vector<unsigned char> last;
+        last.swap(in_view);
+        if (frustum_culling) {
+            in_view.assign(objects.size(), 0);
+            cull_stats = bvh.queryFrustum(frame.frustum, visible_objects);
+            for (uint i = 0; i < visible_objects.size(); i++) {
+                in_view[objects.position(visible_objects[i])] = 1;
+            }
+        } else {
+            in_view.assign(objects.size(), 1);
+            CullStats all = {0, (uint)objects.size(), 0, 0};
+            cull_stats = all;
+        }
+        return last != in_view;
+    }
+    //test only the objects that moved since the last frame, their leaves refitted, returns whether any
+    //came into view or left it. The other objects stay where cullObjects put them
+    bool cullStale() {
+        if (!frustum_culling) { return false; }
+        bool changed = false;
+        for (uint i = 0; i < stale_objects.size(); i++) {
+            Object* object = objects.get(stale_objects[i]);
+            if (!object) { continue; }
+            uint position = objects.position(stale_objects[i]);
+            unsigned char inside = bvh.inFrustum(object->proxy, frame.frustum);
+            if (inside == in_view[position]) { continue; }
+            in_view[position] = inside;
+            if (inside) {
+                cull_stats.visible++;
+                cull_stats.culled--;
+            } else {
+                cull_stats.visible--;
+                cull_stats.culled++;
+            }
+            //light objects are drawn regardless
+            changed = changed || !object->islight;
+        }
+        return changed;
+    }
+    //with write, put the model matrices of the objects that moved since the last frame into the instances
+    //and draws they are drawn from. Batches with levels of detail were filled again anyway
+    void writeStale(bool write) {
+        for (uint i = 0; i < stale_objects.size(); i++) {
+            Object* object = objects.get(stale_objects[i]);
+            if (!object) { continue; }
+            object->stale = false;
+            if (!write || object->entry == Object::NONE) { continue; }
+            if (object->batch == Object::NONE) {
+                indirect.setModel(object->entry, object->getModel());
+            } else if (batches[object->batch].level_first.empty()) {
+                batches[object->batch].setModel(object->entry, object->getModel());
+            }
+        }
+        stale_objects.clear();
+        for (uint i = 0; i < batches.size(); i++) {
+            batches[i].uploadChanged();
+        }
+        indirect.uploadChanged();
+    }
+    void releaseBatches() {
+        for (uint i = 0; i < batches.size(); i++) {
+            batches[i].release();
+        }
+        batches.clear();
+    }
+    //sort the queued objects in view by shader, textures, material and distance to the camera
+    void buildQueue() {
+        queue.clear();
+        for (uint i = 0; i < queued.size(); i++) {
+            if (!in_view[queued[i]]) { continue; }
+            Object& object = objects.at(queued[i]);
+            float depth = -(frame.view * object.getModel()[3]).z;
+            uint64_t key = RenderQueue::makeKey(object.shader & SlotMap<SceneShader>::INDEX_MASK, object.base_mesh->texture_set, object.material & SlotMap<Material>::INDEX_MASK, (depth - Z_NEAR) / (Z_FAR - Z_NEAR));
+            queue.push(key, queued[i]);
+        }
+        queue.sort();
+        queue_version = version;
+        queue_camera = CAMERA.Version;
+    }
+    //write the draw commands of the objects drawn indirectly, at the level of detail each is drawn at.
+    //Unless the scene changed the commands are only written again when an object changed level
+    void buildIndirect(bool changed) {
+        for (uint i = 0; i < indirect_objects.size() && !changed; i++) {
+            Object& object = objects.at(indirect_objects[i]);
+            uint last = object.lod;
+            changed = in_view[indirect_objects[i]] && selectLod(object) != last;
+        }
+        if (!changed) { return; }
+        indirect.clear();
+        indirect_full_triangles = 0;
+        if (indirect_objects.empty()) { return; }
+        for (uint i = 0; i < indirect_objects.size(); i++) {
+            Object& object = objects.at(indirect_objects[i]);
+            object.entry = Object::NONE;
+            if (!in_view[indirect_objects[i]]) { continue; }
+            object.entry = indirect.add(*object.base_mesh, selectLod(object), object.getModel(), object.material & SlotMap<Material>::INDEX_MASK);
+            indirect_full_triangles += object.base_mesh->triangles();
+        }
+        indirect.upload();
+    }
+    //materials are stored at their slot index, which is what instances and indirect draws refer to
+    void uploadMaterials() {
+        uint count = 0;
+        for (uint i = 0; i < materials.size(); i++) {
+            uint slot = materials.handle(i) & SlotMap<Material>::INDEX_MASK;
+            if (slot >= MAX_MATERIALS) { continue; }
+            const Material& m = materials.at(i);
+            material_block[slot].ambient = m.ambient;
+            material_block[slot].diffuse = m.diffuse;
+            material_block[slot].specular = m.specular;
+            material_block[slot].shininess = m.shininess;
+            count = max(count, slot + 1);
+        }
+        glBindBuffer(GL_UNIFORM_BUFFER, material_ubo);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, count * sizeof(MaterialData), material_block);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        materials_dirty = false;
+    }
+    void uploadLights() {
+        glBindBuffer(GL_UNIFORM_BUFFER, light_ubo);
+        uint nr_lights = 0;
+        for (auto it = lights.begin(); it != lights.end() && nr_lights < MAX_LIGHTS; it++, nr_lights++) {
+            Light& light = *it;
+            if (!light.dirty && !lights_relaid) { continue; }
+            light.pack(light_block.lights[nr_lights]);
+            light.dirty = false;
+            if (!lights_relaid) {
+                GLintptr offset = offsetof(LightBlock, lights) + nr_lights * sizeof(LightData);
+                glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(LightData), &light_block.lights[nr_lights]);
+            }
+            stats.light_uploads++;
+        }
+        if (lights_relaid) {
+            //lights were added or removed, rewrite the count and every slot in one go
+            light_block.nr_lights = nr_lights;
+            glBufferSubData(GL_UNIFORM_BUFFER, 0, offsetof(LightBlock, lights) + nr_lights * sizeof(LightData), &light_block);
+            lights_relaid = false;
+        }
+        lights_dirty = false;
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    
     float dim[3];
     int subd[2];
     bool smooth;
+    bool flat_shading;
+    uint vertex_format;
+    bool optimize_meshes;
+    bool triangle_strips;
+    uint lod_levels;
+    float lod_error;
+    float tessellation_tolerance;
     float light_inner_cutoff;
     float light_outer_cutoff;
     glm::vec3 light_constants;
@@ -260,9 +1141,52 @@ private:
     glm::vec3 light_diffuse;
     glm::vec3 light_specular;
     bool render_lights;
+    bool instancing;
+    uint obj_shader;
+    uint instanced_shader;
+    ObjectUniforms instanced_uniforms;
+    vector<InstanceBatch> batches;
+    bool multi_draw;
+    uint indirect_shader;
+    ObjectUniforms indirect_uniforms;
+    IndirectRenderer indirect;
+    //objects drawn by indirect, and the triangles they have at full detail
+    vector<uint> indirect_objects;
+    uint indirect_full_triangles;
+    //objects drawn one by one, the queue orders them
+    vector<uint> queued;
+    bool frustum_culling;
+    //world space boxes of the objects, and the objects changed since their leaves were refitted
+    DynamicBvh bvh;
+    vector<uint> moved_objects;
+    //handles of the objects whose model matrices changed since the last frame
+    vector<uint> stale_objects;
+    //handles of the objects in the frustum, and per position in Scene::objects whether the object is drawn
+    //this frame
+    vector<uint> visible_objects;
+    vector<unsigned char> in_view;
+    CullStats cull_stats;
+    uint light_ubo;
+    LightBlock light_block;
+    FrameContext frame;
+    RenderQueue queue;
+    //incremented when what is drawn and how changes, see getVersion
+    unsigned long version;
+    //set when a light changed and light_ubo has not been written since
+    bool lights_dirty;
+    //set when lights are created or deleted, their slots in light_ubo change
+    bool lights_relaid;
+    //scene and camera versions the queue was sorted for
+    unsigned long queue_version;
+    unsigned int queue_camera;
+    uint material_ubo;
+    MaterialData material_block[MAX_MATERIALS];
+    bool materials_dirty;
 };
 
 const pair<string, string> Scene::default_obj_shader = make_pair("shaders/default_obj_shader.vs", "shaders/default_obj_shader.fs");
 const pair<string, string> Scene::default_light_shader = make_pair("shaders/default_light_shader.vs", "shaders/default_light_shader.fs");
+const pair<string, string> Scene::default_instanced_shader = make_pair("shaders/default_obj_shader_instanced.vs", "shaders/default_obj_shader_instanced.fs");
+const pair<string, string> Scene::default_indirect_shader = make_pair("shaders/default_obj_shader_indirect.vs", "shaders/default_obj_shader_indirect.fs");
 const glm::vec3 Scene::def = glm::vec3(1.0, 1.0, 1.0);
 #endif /* scene_h */
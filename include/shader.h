@@ -8,6 +8,42 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+
+// FNV-1a hash of a uniform name. It is constexpr so hot paths can resolve a uniform
+// without building or hashing a string at runtime: shader.location(uniformHash("model"))
+// ------------------------------------------------------------------------
+constexpr unsigned int uniformHash(const char* name, unsigned int hash = 2166136261u)
+{
+    return *name ? uniformHash(name + 1, (hash ^ (unsigned char)(*name)) * 16777619u) : hash;
+}
+
+// samplers named "<type>N" (texture_diffuse1, texture_specular2, ...) are assigned a fixed texture
+// unit when the program is linked, so meshes can work out where to bind a texture without the shader
+// ------------------------------------------------------------------------
+const char* const SAMPLER_TYPES[] = {"texture_diffuse", "texture_specular", "texture_emission", "texture_normal", "texture_height"};
+const unsigned int SAMPLER_TYPE_COUNT = 5;
+const unsigned int SAMPLERS_PER_TYPE = 3;
+// texture unit of the n-th (starting at 1) sampler of a type, -1 if there is none
+inline int samplerUnit(const std::string &type, unsigned int n)
+{
+    if (n < 1 || n > SAMPLERS_PER_TYPE)
+        return -1;
+    for (unsigned int i = 0; i < SAMPLER_TYPE_COUNT; i++)
+    {
+        if (type == SAMPLER_TYPES[i])
+            return i * SAMPLERS_PER_TYPE + n - 1;
+    }
+    return -1;
+}
+// texture unit of a sampler uniform such as "texture_diffuse1", -1 if it does not follow the convention
+inline int samplerUnit(const std::string &name)
+{
+    size_t digits = name.find_last_not_of("0123456789");
+    if (digits == std::string::npos || digits + 1 == name.size())
+        return -1;
+    return samplerUnit(name.substr(0, digits + 1), std::stoi(name.substr(digits + 1)));
+}
 
 class Shader
 {
@@ -38,9 +74,9 @@ public:
             // close file handlers
             vShaderFile.close();
             fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();
+            // convert stream into string, pasting in the files it includes
+            vertexCode = expandIncludes(vShaderStream.str(), vertexPath);
+            fragmentCode = expandIncludes(fShaderStream.str(), fragmentPath);
         }
         catch (std::ifstream::failure e)
         {
@@ -71,7 +107,8 @@ public:
         // delete the shaders as they're linked into our program now and no longer necessery
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-        
+        // 3. cache the location of every active uniform
+        buildUniformTable();
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -79,66 +116,241 @@ public:
     {
         glUseProgram(ID);
     }
+    // connects a uniform block of this program to a uniform buffer binding point
+    // ------------------------------------------------------------------------
+    void bindBlock(const std::string &name, GLuint binding) const
+    {
+        GLuint index = glGetUniformBlockIndex(ID, name.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, binding);
+    }
+    // uniform locations
+    // ------------------------------------------------------------------------
+    // looks up a uniform by its precomputed name hash, -1 if the uniform is not active
+    GLint location(unsigned int hash) const
+    {
+        if (uniforms.empty())
+            return -1;
+        size_t mask = uniforms.size() - 1;
+        for (size_t i = hash & mask; ; i = (i + 1) & mask)
+        {
+            if (uniforms[i].location == -1)
+                return -1;
+            if (uniforms[i].hash == hash)
+                return uniforms[i].location;
+        }
+    }
+    // looks up a uniform by name, this hashes the string so keep it out of per-frame code
+    GLint location(const std::string &name) const
+    {
+        nameLookups()++;
+        return location(uniformHash(name.c_str()));
+    }
+    // number of uniforms resolved by name since startup, lets callers verify that a frame
+    // only went through cached locations
+    static unsigned int& nameLookups()
+    {
+        static unsigned int count = 0;
+        return count;
+    }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        setBool(location(name), value);
+    }
+    void setBool(GLint loc, bool value) const
+    {
+        glUniform1i(loc, (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        setInt(location(name), value);
+    }
+    void setInt(GLint loc, int value) const
+    {
+        glUniform1i(loc, value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        setFloat(location(name), value);
+    }
+    void setFloat(GLint loc, float value) const
+    {
+        glUniform1f(loc, value);
     }
     // ------------------------------------------------------------------------
     void setVec2(const std::string &name, const glm::vec2 &value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec2(location(name), value);
+    }
+    void setVec2(GLint loc, const glm::vec2 &value) const
+    {
+        glUniform2fv(loc, 1, &value[0]);
     }
     void setVec2(const std::string &name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(location(name), x, y);
     }
     // ------------------------------------------------------------------------
     void setVec3(const std::string &name, const glm::vec3 &value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec3(location(name), value);
+    }
+    void setVec3(GLint loc, const glm::vec3 &value) const
+    {
+        glUniform3fv(loc, 1, &value[0]);
     }
     void setVec3(const std::string &name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(location(name), x, y, z);
     }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        setVec4(location(name), value);
+    }
+    void setVec4(GLint loc, const glm::vec4 &value) const
+    {
+        glUniform4fv(loc, 1, &value[0]);
     }
     void setVec4(const std::string &name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(location(name), x, y, z, w);
     }
     // ------------------------------------------------------------------------
     void setMat2(const std::string &name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(location(name), mat);
+    }
+    void setMat2(GLint loc, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(loc, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat3(const std::string &name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(location(name), mat);
+    }
+    void setMat3(GLint loc, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(loc, 1, GL_FALSE, &mat[0][0]);
     }
     // ------------------------------------------------------------------------
     void setMat4(const std::string &name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(location(name), mat);
+    }
+    void setMat4(GLint loc, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(loc, 1, GL_FALSE, &mat[0][0]);
     }
     
 private:
+    // open addressed table of active uniform locations keyed by name hash,
+    // its size is a power of two and an empty slot has location -1
+    struct UniformSlot
+    {
+        unsigned int hash;
+        GLint location;
+    };
+    std::vector<UniformSlot> uniforms;
+    
+    // GLSL has no #include, so a line `#include "file"` is replaced here by the source of file, found
+    // next to the including one (path). Shaders share code this way, e.g. shaders/lighting.glsl.
+    // #line directives around each include keep compile errors pointing at the line of the file they are in.
+    // ------------------------------------------------------------------------
+    static std::string expandIncludes(const std::string &source, const std::string &path)
+    {
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        std::istringstream lines(source);
+        std::stringstream expanded;
+        std::string line;
+        for (unsigned int number = 1; std::getline(lines, line); number++)
+        {
+            size_t open = line.find('"');
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (line.compare(0, 8, "#include") != 0 || close == std::string::npos)
+            {
+                expanded << line << "\n";
+                continue;
+            }
+            std::string file = directory + line.substr(open + 1, close - open - 1);
+            std::ifstream included(file.c_str());
+            if (!included)
+            {
+                std::cerr << "ERROR::SHADER::INCLUDE_NOT_FOUND " << file << std::endl;
+                continue;
+            }
+            std::stringstream contents;
+            contents << included.rdbuf();
+            expanded << "#line 1\n" << expandIncludes(contents.str(), file) << "#line " << number + 1 << "\n";
+        }
+        return expanded.str();
+    }
+    
+    // queries every active uniform once after linking. Elements of arrays are reported
+    // by the driver only as "name[0]", so each element is registered individually.
+    // Samplers are pointed at their fixed texture unit (see samplerUnit) here as well.
+    // ------------------------------------------------------------------------
+    void buildUniformTable()
+    {
+        std::vector<std::string> samplers;
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<std::string> names;
+        std::vector<GLchar> buffer(maxLength + 1);
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint size;
+            GLenum type;
+            glGetActiveUniform(ID, i, maxLength + 1, NULL, &size, &type, &buffer[0]);
+            std::string name(&buffer[0]);
+            if (type == GL_SAMPLER_2D)
+                samplers.push_back(name);
+            size_t bracket = name.size() >= 3 ? name.rfind("[0]") : std::string::npos;
+            if (bracket != std::string::npos && bracket == name.size() - 3)
+            {
+                std::string base = name.substr(0, bracket);
+                names.push_back(base);
+                for (GLint j = 0; j < size; j++)
+                    names.push_back(base + "[" + std::to_string(j) + "]");
+            }
+            else
+                names.push_back(name);
+        }
+        size_t capacity = 16;
+        while (capacity < 2 * names.size())
+            capacity *= 2;
+        UniformSlot empty = {0, -1};
+        uniforms.assign(capacity, empty);
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            GLint loc = glGetUniformLocation(ID, names[i].c_str());
+            if (loc == -1)
+                continue;
+            unsigned int hash = uniformHash(names[i].c_str());
+            size_t slot = hash & (capacity - 1);
+            while (uniforms[slot].location != -1 && uniforms[slot].hash != hash)
+                slot = (slot + 1) & (capacity - 1);
+            if (uniforms[slot].location != -1 && uniforms[slot].location != loc)
+                std::cerr << "ERROR::SHADER::UNIFORM_HASH_COLLISION: " << names[i] << std::endl;
+            uniforms[slot].hash = hash;
+            uniforms[slot].location = loc;
+        }
+        glUseProgram(ID);
+        for (size_t i = 0; i < samplers.size(); i++)
+        {
+            int unit = samplerUnit(samplers[i]);
+            if (unit >= 0)
+                glUniform1i(location(uniformHash(samplers[i].c_str())), unit);
+        }
+        glUseProgram(0);
+    }
+    
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
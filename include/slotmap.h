@@ -0,0 +1,141 @@
+//
+//  slotmap.h
+//  BasicOpenGL
+//
+
+#ifndef slotmap_h
+#define slotmap_h
+
+#include <cstddef>
+#include <vector>
+
+using namespace std;
+
+//Contiguous storage addressed through generational handles.
+//Items are kept densely packed so iterating over them is a linear scan; erasing moves the last item
+//into the hole. A handle names a slot, the slot knows where its item currently lives, so lookups are
+//O(1). Every erase bumps the generation of the slot, which makes handles to erased items (even
+//after the slot has been reused) resolve to nothing instead of to some other item.
+template <typename T>
+class SlotMap {
+    typedef unsigned int uint;
+public:
+    //a handle keeps the slot index in its low INDEX_BITS and the slot generation above them,
+    //generations start at 0 so the first handles handed out are 0, 1, 2, ...
+    static const uint INDEX_BITS = 20;
+    static const uint INDEX_MASK = (1u << INDEX_BITS) - 1;
+    static const uint GENERATION_MASK = ~0u >> INDEX_BITS;
+    //never returned by insert
+    static const uint INVALID = ~0u;
+
+    typedef typename vector<T>::iterator iterator;
+    typedef typename vector<T>::const_iterator const_iterator;
+
+    SlotMap() : free_head(INVALID) {}
+
+    uint insert(const T& item) {
+        uint index;
+        if (free_head != INVALID) {
+            index = free_head;
+            free_head = slots[index].dense;
+        } else {
+            index = slots.size();
+            if (index >= INDEX_MASK) { return INVALID; }
+            Slot slot = {0, 0};
+            slots.push_back(slot);
+        }
+        slots[index].dense = items.size();
+        items.push_back(item);
+        owners.push_back(index);
+        return handleOf(index);
+    }
+    bool erase(uint handle) {
+        uint index;
+        if (!resolve(handle, index)) { return false; }
+        uint dense = slots[index].dense, last = items.size() - 1;
+        if (dense != last) {
+            items[dense] = items[last];
+            owners[dense] = owners[last];
+            slots[owners[dense]].dense = dense;
+        }
+        items.pop_back();
+        owners.pop_back();
+        slots[index].generation = (slots[index].generation + 1) & GENERATION_MASK;
+        //a free slot's dense field links to the next free slot
+        slots[index].dense = free_head;
+        free_head = index;
+        return true;
+    }
+    //NULL if the handle is stale or was never issued
+    T* get(uint handle) {
+        uint index;
+        return resolve(handle, index) ? &items[slots[index].dense] : NULL;
+    }
+    const T* get(uint handle) const {
+        uint index;
+        return resolve(handle, index) ? &items[slots[index].dense] : NULL;
+    }
+    bool contains(uint handle) const {
+        uint index;
+        return resolve(handle, index);
+    }
+    //handle of the item at position i of the dense storage
+    uint handle(size_t i) const {
+        return handleOf(owners[i]);
+    }
+    //position of an item in the dense storage, it changes when other items are erased
+    size_t position(uint handle) const {
+        uint index;
+        return resolve(handle, index) ? slots[index].dense : size_t(INVALID);
+    }
+    T& at(size_t i) { return items[i]; }
+    const T& at(size_t i) const { return items[i]; }
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+    iterator begin() { return items.begin(); }
+    iterator end() { return items.end(); }
+    const_iterator begin() const { return items.begin(); }
+    const_iterator end() const { return items.end(); }
+    void clear() {
+        //keep the slots so that outstanding handles stay stale
+        for (size_t i = 0; i < owners.size(); i++) {
+            uint index = owners[i];
+            slots[index].generation = (slots[index].generation + 1) & GENERATION_MASK;
+            slots[index].dense = free_head;
+            free_head = index;
+        }
+        items.clear();
+        owners.clear();
+    }
+
+private:
+    struct Slot {
+        //position of the item in items, or the next free slot
+        uint dense;
+        uint generation;
+    };
+    vector<T> items;
+    //slot index of every item in items
+    vector<uint> owners;
+    vector<Slot> slots;
+    uint free_head;
+
+    uint handleOf(uint index) const {
+        return (slots[index].generation << INDEX_BITS) | index;
+    }
+    bool resolve(uint handle, uint& index) const {
+        index = handle & INDEX_MASK;
+        if (index >= slots.size()) { return false; }
+        if (slots[index].generation != (handle >> INDEX_BITS)) { return false; }
+        //a free slot has the generation its next item will get, make sure it is in use
+        uint dense = slots[index].dense;
+        return dense < owners.size() && owners[dense] == index;
+    }
+};
+
+template <typename T> const unsigned int SlotMap<T>::INDEX_BITS;
+template <typename T> const unsigned int SlotMap<T>::INDEX_MASK;
+template <typename T> const unsigned int SlotMap<T>::GENERATION_MASK;
+template <typename T> const unsigned int SlotMap<T>::INVALID;
+
+#endif /* slotmap_h */
@@ -0,0 +1,132 @@
+//
+//  threadpool.h
+//  BasicOpenGL
+//
+
+#ifndef threadpool_h
+#define threadpool_h
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+//Fixed set of worker threads that run the chunks of one parallelFor at a time.
+//The calling thread works on chunks too, so a pool of n threads starts n - 1 workers.
+class ThreadPool {
+    typedef unsigned int uint;
+public:
+    //fn(lo, hi) handles the indices lo <= i < hi
+    typedef function<void(uint, uint)> RangeFunction;
+
+    explicit ThreadPool(uint threads = 0) : job(NULL), generation(0), stopping(false) {
+        setThreads(threads);
+    }
+    ~ThreadPool() {
+        stop();
+    }
+    //threads including the caller, 0 picks one per hardware thread
+    void setThreads(uint threads) {
+        stop();
+        if (threads == 0) { threads = max(1u, thread::hardware_concurrency()); }
+        stopping = false;
+        for (uint i = 1; i < threads; i++) {
+            workers.push_back(thread(&ThreadPool::work, this));
+        }
+    }
+    uint size() const {
+        return workers.size() + 1;
+    }
+    //split [begin, end) into chunks of grain indices and run fn over them on every thread, returns when
+    //all chunks are done. Ranges of at most grain indices run on the caller alone. Not reentrant: fn
+    //must not call parallelFor on the same pool.
+    void parallelFor(uint begin, uint end, uint grain, const RangeFunction& fn) {
+        if (begin >= end) { return; }
+        grain = max(grain, 1u);
+        if (workers.empty() || end - begin <= grain) {
+            fn(begin, end);
+            return;
+        }
+        lock_guard<mutex> serial(running);
+        Job current(fn, begin, end, grain);
+        {
+            lock_guard<mutex> lock(m);
+            job = &current;
+            generation++;
+        }
+        wake.notify_all();
+        uint ran = current.run();
+        unique_lock<mutex> lock(m);
+        current.finished += ran;
+        //workers still holding the job may touch it, wait for them to let go before it goes out of scope
+        done.wait(lock, [&current]() { return current.finished == current.chunks && current.active == 0; });
+        job = NULL;
+    }
+    //pool shared by the mesh builders
+    static ThreadPool& shared() {
+        static ThreadPool pool;
+        return pool;
+    }
+
+private:
+    struct Job {
+        const RangeFunction& fn;
+        uint begin, end, grain, chunks;
+        atomic<uint> next;
+        //chunks completed and workers running chunks, guarded by the pool mutex
+        uint finished, active;
+        Job(const RangeFunction& f, uint b, uint e, uint g) : fn(f), begin(b), end(e), grain(g), chunks((e - b + g - 1) / g), next(0), finished(0), active(0) {}
+        //take chunks until there are none left, returns how many this thread ran
+        uint run() {
+            uint ran = 0;
+            for (uint c = next++; c < chunks; c = next++) {
+                uint lo = begin + c * grain;
+                fn(lo, min(end, lo + grain));
+                ran++;
+            }
+            return ran;
+        }
+    };
+    vector<thread> workers;
+    mutex m, running;
+    condition_variable wake, done;
+    Job* job;
+    unsigned long generation;
+    bool stopping;
+
+    void work() {
+        unsigned long seen = 0;
+        unique_lock<mutex> lock(m);
+        while (true) {
+            wake.wait(lock, [this, seen]() { return stopping || (job && generation != seen); });
+            if (stopping) { return; }
+            seen = generation;
+            Job* current = job;
+            current->active++;
+            lock.unlock();
+            uint ran = current->run();
+            lock.lock();
+            current->finished += ran;
+            current->active--;
+            if (current->finished == current->chunks && current->active == 0) { done.notify_all(); }
+        }
+    }
+    void stop() {
+        {
+            lock_guard<mutex> lock(m);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (uint i = 0; i < workers.size(); i++) {
+            workers[i].join();
+        }
+        workers.clear();
+    }
+};
+
+#endif /* threadpool_h */
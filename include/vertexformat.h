@@ -0,0 +1,132 @@
+//
+//  vertexformat.h
+//  BasicOpenGL
+//
+
+#ifndef vertexformat_h
+#define vertexformat_h
+
+#include <glad/glad.h> // holds all OpenGL type declarations
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+//A vertex format is a set of these flags. It picks the attributes a mesh uploads, the Vertex struct
+//itself always holds all of them. Attribute locations do not change with the format:
+//0 position, 1 normal, 2 texture coordinates, 3 tangent, 4 bitangent.
+const unsigned int VERTEX_POSITION = 1;
+const unsigned int VERTEX_NORMAL = 2;
+const unsigned int VERTEX_UV = 4;
+//tangent and bitangent
+const unsigned int VERTEX_TANGENTS = 8;
+//positions as 3 x 16 bit fractions of the mesh bounds, normals octahedral encoded in 2 x 16 bits and
+//texture coordinates as half floats. Shaders decode them, see Mesh::position_offset
+const unsigned int VERTEX_QUANTIZED = 16;
+//what Vertex holds, 56 bytes a vertex
+const unsigned int VERTEX_FULL = VERTEX_POSITION | VERTEX_NORMAL | VERTEX_UV | VERTEX_TANGENTS;
+
+//where each attribute of a format lives in an interleaved vertex
+struct VertexLayout {
+    unsigned int stride;
+    //byte offsets of position, normal, uv, tangent and bitangent, only valid for attributes in the format
+    unsigned int offset[5];
+    explicit VertexLayout(unsigned int format) : stride(0) {
+        bool q = format & VERTEX_QUANTIZED;
+        unsigned int size[5] = {q ? 8u : 12u, q ? 4u : 12u, q ? 4u : 8u, 12, 12};
+        unsigned int flag[5] = {VERTEX_POSITION, VERTEX_NORMAL, VERTEX_UV, VERTEX_TANGENTS, VERTEX_TANGENTS};
+        for (unsigned int i = 0; i < 5; i++) {
+            offset[i] = stride;
+            if (format & flag[i]) { stride += size[i]; }
+        }
+    }
+};
+
+//nearest half float to f, values beyond the half range become infinity
+inline uint16_t toHalf(float f) {
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint32_t sign = (x >> 16) & 0x8000, mantissa = x & 0x7FFFFF;
+    int exponent = int((x >> 23) & 0xFF) - 127 + 15;
+    if (((x >> 23) & 0xFF) == 0xFF) { return uint16_t(sign | 0x7C00 | (mantissa ? 0x200 : 0)); }
+    if (exponent >= 31) { return uint16_t(sign | 0x7C00); }
+    if (exponent <= 0) {
+        //subnormal half, or zero
+        if (exponent < -10) { return uint16_t(sign); }
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift, rest = mantissa & ((1u << shift) - 1), mid = 1u << (shift - 1);
+        if (rest > mid || (rest == mid && (half & 1))) { half++; }
+        return uint16_t(sign | half);
+    }
+    uint32_t half = (uint32_t(exponent) << 10) | (mantissa >> 13), rest = mantissa & 0x1FFF;
+    //round to nearest even, a carry into the exponent is still the right value
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) { half++; }
+    return uint16_t(sign | half);
+}
+
+//unit vector n folded onto the octahedron and unfolded onto the square [-1, 1]^2, as 16 bit snorms.
+//The shaders invert this in octDecode
+inline void octEncode(glm::vec3 n, int16_t out[2]) {
+    float l1 = fabs(n.x) + fabs(n.y) + fabs(n.z);
+    glm::vec2 p = l1 > 0 ? glm::vec2(n.x, n.y) / l1 : glm::vec2(0.0f);
+    if (n.z < 0) {
+        glm::vec2 folded = glm::vec2(1.0f - fabs(p.y), 1.0f - fabs(p.x));
+        p = glm::vec2(p.x >= 0 ? folded.x : -folded.x, p.y >= 0 ? folded.y : -folded.y);
+    }
+    for (unsigned int i = 0; i < 2; i++) {
+        float c = p[i] < -1.0f ? -1.0f : (p[i] > 1.0f ? 1.0f : p[i]);
+        out[i] = int16_t(floor(c * 32767.0f + 0.5f));
+    }
+}
+
+//set the vertex attribute pointers of format for the vertex buffer bound to GL_ARRAY_BUFFER, and disable
+//the attributes it does not have: a vertex array set up again for another format may have more enabled
+inline void setupVertexAttributes(unsigned int format) {
+    VertexLayout layout(format);
+    bool quantized = format & VERTEX_QUANTIZED;
+    for (unsigned int i = 0; i < 5; i++) {
+        glDisableVertexAttribArray(i);
+    }
+    //positions
+    if (format & VERTEX_POSITION) {
+        glEnableVertexAttribArray(0);
+        if (quantized) {
+            glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.offset[0]);
+        } else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.offset[0]);
+        }
+    }
+    //normals
+    if (format & VERTEX_NORMAL) {
+        glEnableVertexAttribArray(1);
+        if (quantized) {
+            glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.offset[1]);
+        } else {
+            glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.offset[1]);
+        }
+    }
+    //texture coordinates
+    if (format & VERTEX_UV) {
+        glEnableVertexAttribArray(2);
+        if (quantized) {
+            glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.offset[2]);
+        } else {
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.offset[2]);
+        }
+    }
+    //tangents and bitangents
+    if (format & VERTEX_TANGENTS) {
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.offset[3]);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.offset[4]);
+    }
+}
+
+#endif /* vertexformat_h */
@@ -42,7 +42,8 @@ unsigned int loadTexture(char const*);
 
 int main() {
     glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    //4.3 draws with glMultiDrawElementsIndirect, 3.3 is enough for everything else
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     
@@ -51,6 +52,11 @@ int main() {
 #endif
     
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Opengl-Dryrun", NULL, NULL);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Opengl-Dryrun", NULL, NULL);
+    }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
@@ -67,6 +73,8 @@ int main() {
     glEnable(GL_DEPTH_TEST);
     
     Scene myscene;
+    //objects are drawn one by one where the context is older than 4.3
+    myscene.setMultiDrawIndirect(true, (GLADloadproc)glfwGetProcAddress);
     //myscene.setSmooth(true);
     //myscene.createObject(ELLIPSOID, {1.0, 1.0, 1.0});
     //myscene.setSmooth(true);
@@ -11,40 +11,14 @@ in vec2 TexCoords;
 
 out vec4 FragColor;
 
-struct Material {
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-    float shininess;
-};
+#include "lighting.glsl"
 
-struct Light {
-    //enum{POINTLIGHT, DIRECTEDLIGHT, SPOTLIGHT}
-    int ltype;
-    
-    vec3 position;
-    vec3 direction;
-    
-    //only for spotlights
-    float inner_cutoff;
-    float outer_cutoff;
-    
-    vec3 constants;
-    
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;
-};
-
-#define MAX_LIGHTS 100
 uniform sampler2D texture_diffuse1;
 uniform sampler2D texture_specular1;
 uniform sampler2D texture_emission1;
 uniform bool textured;
-uniform int nr_lights;
 uniform int light_idx;
 uniform Material material;
-uniform Light lights[MAX_LIGHTS];
 
 void main()
 {
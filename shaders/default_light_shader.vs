@@ -17,10 +17,15 @@ out vec2 TexCoords;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+//set for meshes with VERTEX_QUANTIZED, positions are fractions of the mesh bounds
+uniform bool quantized;
+uniform vec3 position_offset;
+uniform vec3 position_scale;
 
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
+    vec3 pos = quantized ? position_offset + aPos * position_scale : aPos;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
     //Normal = mat3(transpose(inverse(model))) * aNormal;
     TexCoords = aTexCoords;
 }
@@ -17,11 +17,25 @@ out vec2 TexCoords;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+//set for meshes with VERTEX_QUANTIZED: positions are fractions of the mesh bounds, normals octahedral
+uniform bool quantized;
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
 
 void main() {
-    gl_Position = projection * view * model * vec4(aPos, 1.0);
-    Normal = mat3(transpose(inverse(model))) * aNormal;
-    FragPos = vec3(model * vec4(aPos, 1.0));
+    vec3 pos = quantized ? position_offset + aPos * position_scale : aPos;
+    vec3 normal = quantized ? octDecode(aNormal.xy) : aNormal;
+    gl_Position = projection * view * model * vec4(pos, 1.0);
+    Normal = mat3(transpose(inverse(model))) * normal;
+    FragPos = vec3(model * vec4(pos, 1.0));
     TexCoords = aTexCoords;
 }
 
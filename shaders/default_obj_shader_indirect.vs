@@ -0,0 +1,53 @@
+//
+//  default_obj_shader_indirect.vs
+//  BasicOpenGL
+//
+
+#version 430 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+//index of the draw's DrawData, an instanced attribute started at the command's baseInstance
+layout (location = 5) in uint aDrawID;
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+flat out uint MaterialIdx;
+flat out uint Flat;
+
+//see DrawData in indirect.h
+struct DrawData {
+    mat4 model;
+    //w is 1 for meshes with VERTEX_QUANTIZED
+    vec4 position_offset;
+    vec4 position_scale;
+    uint material;
+    uint flat_shading;
+};
+layout (std430, binding = 0) readonly buffer DrawBlock {
+    DrawData draws[];
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    DrawData draw = draws[aDrawID];
+    bool quantized = draw.position_offset.w > 0.5;
+    vec3 pos = quantized ? draw.position_offset.xyz + aPos * draw.position_scale.xyz : aPos;
+    vec3 normal = quantized ? octDecode(aNormal.xy) : aNormal;
+    gl_Position = projection * view * draw.model * vec4(pos, 1.0);
+    Normal = mat3(transpose(inverse(draw.model))) * normal;
+    FragPos = vec3(draw.model * vec4(pos, 1.0));
+    TexCoords = aTexCoords;
+    MaterialIdx = draw.material;
+    Flat = draw.flat_shading;
+}
@@ -0,0 +1,32 @@
+//
+//  default_obj_shader_instanced.fs
+//  BasicOpenGL
+//
+
+#version 330 core
+in vec3 Normal;
+in vec3 FragPos;
+in vec2 TexCoords;
+flat in uint MaterialIdx;
+out vec4 FragColor;
+
+#include "lighting.glsl"
+
+uniform vec3 CameraPos;
+//while doing light calculations in the model space CameraPos should be enabled
+//use the normal of the triangle instead of the interpolated vertex normal, the mesh is not faceted
+uniform bool flat_shading;
+
+void main() {
+    //flat normal from the screen space derivatives, see default_obj_shader.fs
+    vec3 facet = normalize(cross(dFdx(FragPos), dFdy(FragPos)));
+    vec3 norm = flat_shading ? (gl_FrontFacing ? facet : -facet) : normalize(Normal);
+    vec3 view_dir = normalize(CameraPos - FragPos);
+    //Calculate effects of all lights
+    vec3 result = vec3(0.0, 0.0, 0.0);
+    Material material = materials[MaterialIdx];
+    for (int i = 0; i < nr_lights; i++) {
+        result += LightEffect(lights[i], material, vec3(0.0), FragPos, norm, view_dir);
+    }
+    FragColor = vec4(result, 1.0);
+}
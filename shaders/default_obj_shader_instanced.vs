@@ -0,0 +1,41 @@
+//
+//  default_obj_shader_instanced.vs
+//  BasicOpenGL
+//
+
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+//per instance attributes, see InstanceData
+layout (location = 5) in mat4 aModel;
+layout (location = 9) in uint aMaterial;
+out vec3 Normal;
+out vec3 FragPos;
+out vec2 TexCoords;
+flat out uint MaterialIdx;
+
+uniform mat4 view;
+uniform mat4 projection;
+//set for meshes with VERTEX_QUANTIZED: positions are fractions of the mesh bounds, normals octahedral
+uniform bool quantized;
+uniform vec3 position_offset;
+uniform vec3 position_scale;
+
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    }
+    return normalize(n);
+}
+
+void main() {
+    vec3 pos = quantized ? position_offset + aPos * position_scale : aPos;
+    vec3 normal = quantized ? octDecode(aNormal.xy) : aNormal;
+    gl_Position = projection * view * aModel * vec4(pos, 1.0);
+    Normal = mat3(transpose(inverse(aModel))) * normal;
+    FragPos = vec3(aModel * vec4(pos, 1.0));
+    TexCoords = aTexCoords;
+    MaterialIdx = aMaterial;
+}
@@ -0,0 +1,83 @@
+//
+//  lighting.glsl
+//  BasicOpenGL
+//
+//  Lights and materials of the default shaders, which paste this file in with #include "lighting.glsl"
+//  (see Shader::expandIncludes). LightData and MaterialData in scene.h are the std140 images of the
+//  structs below.
+//
+
+struct Material {
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+    float shininess;
+};
+
+struct Light {
+    //enum{POINTLIGHT, DIRECTEDLIGHT, SPOTLIGHT}
+    int ltype;
+    
+    vec3 position;
+    vec3 direction;
+    
+    //only for spotlights
+    float inner_cutoff;
+    float outer_cutoff;
+    
+    vec3 constants;
+    
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+};
+
+#define MAX_LIGHTS 100
+#define MAX_MATERIALS 256
+//shared by all shaders, bound to LIGHT_BLOCK_BINDING by the scene
+layout (std140) uniform LightBlock {
+    int nr_lights;
+    Light lights[MAX_LIGHTS];
+};
+//untextured instanced and indirectly drawn objects get their materials from here, indexed per instance
+//or per draw, bound to MATERIAL_BLOCK_BINDING by the scene
+layout (std140) uniform MaterialBlock {
+    Material materials[MAX_MATERIALS];
+};
+
+//light reaching the eye from the surface at frag_pos, the emission fades with the light's attenuation
+vec3 LightEffect(Light light, Material material, vec3 emission, vec3 frag_pos, vec3 normal, vec3 view_dir) {
+    vec3 light_dir = (light.ltype == 1 ? normalize(-light.direction) : normalize(light.position - frag_pos));
+    vec3 reflect_dir = reflect(-light_dir, normal);
+    
+    float attenuation = 1, intensity = 1;
+    if (light.ltype == 0 || light.ltype == 2) {
+        float distance = length(light.position - frag_pos);
+        attenuation = 1 / (light.constants[0] * distance + light.constants[1] * distance + light.constants[2] * (distance * distance));
+        if (light.ltype == 2) {
+            float theta = dot(light_dir, normalize(-light.direction));
+            float epsilon = light.inner_cutoff - light.outer_cutoff;
+            intensity = clamp((theta - light.outer_cutoff) / epsilon, 0.0, 1.0);
+        }
+    }
+    //ambient
+    vec3 ambient = light.ambient * material.ambient;
+    
+    //diffuse
+    float diff =max(dot(normal, light_dir), 0.0);
+    vec3 diffuse = diff * light.diffuse * material.diffuse;
+    
+    //specular
+    float spec = pow(max(dot(view_dir, reflect_dir), 0.0), material.shininess);
+    vec3 specular = spec * light.specular * material.specular;
+    
+    //attenuation
+    //ambient light shouldn't attenuate
+    ambient *= intensity;
+    diffuse *= intensity * attenuation;
+    specular *= intensity * attenuation;
+    emission *= 10 * attenuation;
+    
+    vec3 result = ambient + diffuse + specular + emission;
+    return result;
+}
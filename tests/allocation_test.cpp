@@ -0,0 +1,98 @@
+//
+//  allocation_test.cpp
+//  BasicOpenGL
+//
+//  Heap allocations made while building a primitive, counted by replacing the global operator new. The
+//  builders reserve their arrays once, so the count must not grow with the number of vertices: a
+//  1000x1000 ellipsoid has to make no more allocations than a 10x10 one. Prints the build times too.
+//
+
+#include <primitive.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+using namespace std;
+
+static atomic<unsigned long> allocations(0);
+
+//gcc pairs the operator new inlined into a caller with the free below and warns, both are this file's
+#if defined(__GNUC__) && !defined(__clang__) && __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(size_t size) {
+    allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) { throw bad_alloc(); }
+    return p;
+}
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+void operator delete(void* p) noexcept {
+    free(p);
+}
+void operator delete[](void* p) noexcept {
+    free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+    free(p);
+}
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, const char* shape) {
+    if (!ok) {
+        printf("FAILED: %s (%s)\n", what, shape);
+        failures++;
+    }
+}
+
+//allocations and milliseconds of building the primitive of k, after a first build that leaves the
+//shared thread pool and anything else made once behind
+static unsigned long build(const PrimitiveKey& k, double& ms, unsigned int& vertices) {
+    { Primitive warm(k, NO_UVMAP, false); }
+    unsigned long before = allocations;
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    Primitive p(k, NO_UVMAP, false);
+    ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    vertices = p.vertices.size();
+    return allocations - before;
+}
+
+struct Case {
+    const char* name;
+    Shape sh;
+    bool smooth;
+    unsigned int small, large;
+};
+
+int main() {
+    //faceted meshes have a vertex per index, 1000x1000 would need gigabytes
+    const Case cases[] = {
+        {"ellipsoid", ELLIPSOID, true, 10, 1000},
+        {"torus", TORUS, true, 10, 500},
+        {"cylinder", CYLINDER, true, 10, 100000},
+        {"faceted ellipsoid", ELLIPSOID, false, 10, 300},
+        {"faceted torus", TORUS, false, 10, 150},
+    };
+    for (unsigned int c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const Case& t = cases[c];
+        double small_ms, large_ms;
+        unsigned int small_vertices, large_vertices;
+        unsigned long small = build(Primitive::makeKey(t.sh, t.smooth, 2.0f, 1.5f, 0.5f, t.small, t.small), small_ms, small_vertices);
+        unsigned long large = build(Primitive::makeKey(t.sh, t.smooth, 2.0f, 1.5f, 0.5f, t.large, t.large), large_ms, large_vertices);
+        check(large <= small, "allocations do not grow with the vertices", t.name);
+        printf("%-18s subd %4u: %9u vertices %3lu allocations %8.3f ms   subd %4u: %9u vertices %3lu allocations %8.3f ms\n",
+               t.name, t.small, small_vertices, small, small_ms, t.large, large_vertices, large, large_ms);
+    }
+    printf("allocation_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
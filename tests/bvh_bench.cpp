@@ -0,0 +1,142 @@
+//
+//  bvh_bench.cpp
+//  BasicOpenGL
+//
+//  Cost of DynamicBvh against the number of objects: building the tree, refitting 10% of the objects
+//  moved a little (they stay within their enlarged boxes), moving 10% far (they are reinserted), and
+//  the frustum, box, radius and 16 nearest queries, the frustum next to the linear FrustumCuller.
+//  Objects are random boxes in a cube that grows with their number so the density stays the same.
+//  Every object the linear culler keeps has to be found by the tree, the program fails otherwise.
+//  Pass the number of queries to average, 1000 by default.
+//
+
+#include <bvh.h>
+#include <culling.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::high_resolution_clock Clock;
+
+static double since(Clock::time_point start) {
+    return chrono::duration<double, milli>(Clock::now() - start).count();
+}
+
+static float uniform(float lo, float hi) {
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+static glm::vec3 uniform3(float lo, float hi) {
+    return glm::vec3(uniform(lo, hi), uniform(lo, hi), uniform(lo, hi));
+}
+
+int main(int argc, char** argv) {
+    unsigned int queries = argc > 1 ? max(1, atoi(argv[1])) : 1000;
+    //a camera at the middle of the world looking along a diagonal
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 vp = proj * view;
+    glm::vec4 row[4], planes[6];
+    for (int i = 0; i < 4; i++) { row[i] = glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]); }
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = row[3] + row[i];
+        planes[2 * i + 1] = row[3] - row[i];
+    }
+    for (int i = 0; i < 6; i++) { planes[i] /= glm::length(glm::vec3(planes[i])); }
+
+    printf("%u queries averaged, build to move in ms, frustum in ms, box to knn16 in us\n", queries);
+    printf("%7s %8s %7s %7s %6s %8s %8s %7s %7s %7s\n", "objects", "build", "refit", "move", "height", "linear", "bvh", "box", "radius", "knn16");
+    const unsigned int counts[] = {1000, 10000, 50000, 100000, 200000};
+    unsigned int misses = 0;
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        unsigned int n = counts[c];
+        float world = 20.0f * cbrt(n / 1000.0f);
+        srand(7);
+        vector<glm::vec3> lo(n), hi(n);
+        for (unsigned int i = 0; i < n; i++) {
+            glm::vec3 center = uniform3(-world, world), half = uniform3(0.2f, 1.5f);
+            lo[i] = center - half;
+            hi[i] = center + half;
+        }
+
+        DynamicBvh bvh;
+        vector<unsigned int> leaves(n);
+        Clock::time_point start = Clock::now();
+        for (unsigned int i = 0; i < n; i++) { leaves[i] = bvh.insert(i, lo[i], hi[i]); }
+        double build = since(start);
+
+        //a tenth of the objects each time, the same ones for refit and move
+        unsigned int moved = n / 10;
+        vector<unsigned int> which(moved);
+        vector<glm::vec3> nudge(moved), jump(moved);
+        for (unsigned int i = 0; i < moved; i++) {
+            which[i] = rand() % n;
+            nudge[i] = uniform3(-0.04f, 0.04f);
+            jump[i] = uniform3(-world / 4, world / 4);
+        }
+        start = Clock::now();
+        for (unsigned int i = 0; i < moved; i++) {
+            unsigned int o = which[i];
+            lo[o] += nudge[i];
+            hi[o] += nudge[i];
+            bvh.move(leaves[o], lo[o], hi[o]);
+        }
+        double refit = since(start);
+        start = Clock::now();
+        for (unsigned int i = 0; i < moved; i++) {
+            unsigned int o = which[i];
+            lo[o] += jump[i];
+            hi[o] += jump[i];
+            bvh.move(leaves[o], lo[o], hi[o]);
+        }
+        double move = since(start);
+
+        //the linear culler over the same boxes, each bounded by the sphere around its box as well
+        FrustumCuller culler;
+        culler.resize(n);
+        glm::mat4 identity(1.0f);
+        for (unsigned int i = 0; i < n; i++) {
+            culler.set(i, identity, (lo[i] + hi[i]) * 0.5f, glm::length(hi[i] - lo[i]) * 0.5f, lo[i], hi[i]);
+        }
+        vector<unsigned char> inside;
+        vector<unsigned int> found;
+        start = Clock::now();
+        for (unsigned int q = 0; q < queries; q++) { culler.cull(planes, inside); }
+        double linear = since(start) / queries;
+        start = Clock::now();
+        for (unsigned int q = 0; q < queries; q++) { bvh.queryFrustum(planes, found); }
+        double tree = since(start) / queries;
+        vector<unsigned char> taken(n, 0);
+        for (unsigned int i = 0; i < found.size(); i++) { taken[found[i]] = 1; }
+        for (unsigned int i = 0; i < n; i++) {
+            if (inside[i] && !taken[i]) { misses++; }
+        }
+
+        vector<glm::vec3> centers(queries), halves(queries);
+        vector<float> radii(queries);
+        for (unsigned int q = 0; q < queries; q++) {
+            centers[q] = uniform3(-world, world);
+            halves[q] = uniform3(0.5f, 6.0f);
+            radii[q] = uniform(0.5f, 6.0f);
+        }
+        start = Clock::now();
+        for (unsigned int q = 0; q < queries; q++) { bvh.queryBox(centers[q] - halves[q], centers[q] + halves[q], found); }
+        double box = since(start) * 1000.0 / queries;
+        start = Clock::now();
+        for (unsigned int q = 0; q < queries; q++) { bvh.querySphere(centers[q], radii[q], found); }
+        double radius = since(start) * 1000.0 / queries;
+        start = Clock::now();
+        for (unsigned int q = 0; q < queries; q++) { bvh.queryNearest(centers[q], 16, found); }
+        double nearest = since(start) * 1000.0 / queries;
+
+        printf("%7u %8.3f %7.3f %7.3f %6u %8.4f %8.4f %7.2f %7.2f %7.2f\n", n, build, refit, move, bvh.stats().height, linear, tree, box, radius, nearest);
+    }
+    if (misses) { printf("MISMATCH: %u objects kept by the linear culler were not found by the tree\n", misses); }
+    return misses ? 1 : 0;
+}
@@ -0,0 +1,214 @@
+//
+//  bvh_test.cpp
+//  BasicOpenGL
+//
+//  DynamicBvh queries against a brute force search over the same boxes, before and after objects are
+//  moved, removed and inserted again, and the height of the tree after inserting sorted boxes.
+//
+
+#include <bvh.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <set>
+#include <vector>
+
+using namespace std;
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, unsigned int n) {
+    if (!ok) {
+        printf("FAILED: %s (%u)\n", what, n);
+        failures++;
+    }
+}
+
+static float uniform(float lo, float hi) {
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+static glm::vec3 uniform3(float lo, float hi) {
+    return glm::vec3(uniform(lo, hi), uniform(lo, hi), uniform(lo, hi));
+}
+
+struct Box {
+    glm::vec3 lo, hi;
+    bool alive;
+    unsigned int leaf;
+};
+
+static float distance2(const glm::vec3& p, const Box& b) {
+    glm::vec3 d = glm::max(glm::max(b.lo - p, p - b.hi), glm::vec3(0.0f));
+    return glm::dot(d, d);
+}
+
+//the objects a query returned, once each
+static bool unique(const vector<unsigned int>& found, set<unsigned int>& out) {
+    out = set<unsigned int>(found.begin(), found.end());
+    return out.size() == found.size();
+}
+
+//every query against brute force over the live boxes, world is the half size of the space they are in
+static void compare(const DynamicBvh& bvh, const vector<Box>& boxes, float world, const glm::vec4 planes[6], unsigned int round) {
+    unsigned int alive = 0;
+    for (unsigned int i = 0; i < boxes.size(); i++) { alive += boxes[i].alive; }
+    check(bvh.size() == alive && bvh.stats().leaves == alive, "one leaf per object", round);
+
+    vector<unsigned int> found;
+    set<unsigned int> got;
+    bvh.queryFrustum(planes, found);
+    check(unique(found, got), "frustum objects reported once", round);
+    unsigned int wrong = 0;
+    for (unsigned int i = 0; i < boxes.size(); i++) {
+        glm::vec3 c = (boxes[i].lo + boxes[i].hi) * 0.5f, e = (boxes[i].hi - boxes[i].lo) * 0.5f;
+        bool inside = boxes[i].alive;
+        for (int p = 0; p < 6 && inside; p++) {
+            glm::vec3 n(planes[p]);
+            inside = glm::dot(n, c) + planes[p].w + glm::dot(glm::abs(n), e) >= 0.0f;
+        }
+        wrong += inside != (got.count(i) > 0);
+    }
+    check(wrong == 0, "queryFrustum matches brute force", round);
+
+    for (int q = 0; q < 40; q++) {
+        glm::vec3 c = uniform3(-world, world), half = uniform3(0.5f, 6.0f);
+        float radius = uniform(0.5f, 6.0f);
+        unsigned int box_wrong = 0, sphere_wrong = 0;
+        bvh.queryBox(c - half, c + half, found);
+        check(unique(found, got), "box objects reported once", round);
+        for (unsigned int i = 0; i < boxes.size(); i++) {
+            bool overlaps = boxes[i].alive && glm::all(glm::lessThanEqual(boxes[i].lo, c + half)) && glm::all(glm::lessThanEqual(c - half, boxes[i].hi));
+            box_wrong += overlaps != (got.count(i) > 0);
+        }
+        bvh.querySphere(c, radius, found);
+        check(unique(found, got), "sphere objects reported once", round);
+        for (unsigned int i = 0; i < boxes.size(); i++) {
+            bool near = boxes[i].alive && distance2(c, boxes[i]) <= radius * radius;
+            sphere_wrong += near != (got.count(i) > 0);
+        }
+        check(box_wrong == 0, "queryBox matches brute force", round);
+        check(sphere_wrong == 0, "querySphere matches brute force", round);
+
+        //the k nearest: k objects, nearest first, none farther than the k-th nearest live box
+        unsigned int k = 1 + rand() % 24;
+        bvh.queryNearest(c, k, found);
+        vector<float> distances;
+        for (unsigned int i = 0; i < boxes.size(); i++) {
+            if (boxes[i].alive) { distances.push_back(distance2(c, boxes[i])); }
+        }
+        unsigned int want = min<unsigned int>(k, distances.size());
+        check(found.size() == want && unique(found, got), "queryNearest returns k objects", round);
+        if (!want) { continue; }
+        nth_element(distances.begin(), distances.begin() + (want - 1), distances.end());
+        float kth = distances[want - 1];
+        unsigned int nearest_wrong = 0;
+        for (unsigned int j = 0; j < found.size(); j++) {
+            nearest_wrong += !boxes[found[j]].alive || distance2(c, boxes[found[j]]) > kth;
+            nearest_wrong += j && distance2(c, boxes[found[j]]) < distance2(c, boxes[found[j - 1]]);
+        }
+        check(nearest_wrong == 0, "queryNearest matches brute force", round);
+    }
+}
+
+static void testQueries() {
+    srand(11);
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 60.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(1.0f, 0.2f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 vp = proj * view;
+    glm::vec4 row[4], planes[6];
+    for (int i = 0; i < 4; i++) { row[i] = glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]); }
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = row[3] + row[i];
+        planes[2 * i + 1] = row[3] - row[i];
+    }
+    for (int i = 0; i < 6; i++) { planes[i] /= glm::length(glm::vec3(planes[i])); }
+
+    const unsigned int n = 3000;
+    const float world = 40.0f;
+    DynamicBvh bvh;
+    vector<Box> boxes(n);
+    for (unsigned int i = 0; i < n; i++) {
+        glm::vec3 c = uniform3(-world, world), half = uniform3(0.2f, 1.5f);
+        boxes[i].lo = c - half;
+        boxes[i].hi = c + half;
+        boxes[i].alive = true;
+        boxes[i].leaf = bvh.insert(i, boxes[i].lo, boxes[i].hi);
+    }
+    compare(bvh, boxes, world, planes, 0);
+    for (unsigned int round = 1; round <= 6; round++) {
+        for (unsigned int i = 0; i < n; i++) {
+            Box& b = boxes[i];
+            unsigned int what = rand() % 10;
+            if (!b.alive) {
+                //removed objects come back somewhere else
+                if (what < 5) {
+                    glm::vec3 c = uniform3(-world, world), half = uniform3(0.2f, 1.5f);
+                    b.lo = c - half;
+                    b.hi = c + half;
+                    b.alive = true;
+                    b.leaf = bvh.insert(i, b.lo, b.hi);
+                }
+            } else if (what < 3) {
+                //within the enlarged box, only the leaf changes
+                glm::vec3 d = uniform3(-0.04f, 0.04f);
+                b.lo += d;
+                b.hi += d;
+                bvh.move(b.leaf, b.lo, b.hi);
+            } else if (what < 5) {
+                //far, the leaf is reinserted
+                glm::vec3 d = uniform3(-8.0f, 8.0f);
+                b.lo += d;
+                b.hi += d;
+                bvh.move(b.leaf, b.lo, b.hi);
+            } else if (what < 6) {
+                bvh.remove(b.leaf);
+                b.alive = false;
+            }
+        }
+        compare(bvh, boxes, world, planes, round);
+    }
+    //down to nothing and back
+    for (unsigned int i = 0; i < n; i++) {
+        if (boxes[i].alive) {
+            bvh.remove(boxes[i].leaf);
+            boxes[i].alive = false;
+        }
+    }
+    compare(bvh, boxes, world, planes, 7);
+    for (unsigned int i = 0; i < n; i += 3) {
+        boxes[i].alive = true;
+        boxes[i].leaf = bvh.insert(i, boxes[i].lo, boxes[i].hi);
+    }
+    compare(bvh, boxes, world, planes, 8);
+}
+
+//boxes inserted in order along a line, the worst case for a tree that is not rebalanced
+static void testHeight() {
+    const unsigned int counts[] = {16, 1000, 20000};
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        unsigned int n = counts[c];
+        DynamicBvh line, grid;
+        for (unsigned int i = 0; i < n; i++) {
+            glm::vec3 lo(float(i), 0.0f, 0.0f);
+            line.insert(i, lo, lo + glm::vec3(0.5f));
+            glm::vec3 cell(float(i % 32), float(i / 32 % 32), float(i / 1024));
+            grid.insert(i, cell, cell + glm::vec3(0.5f));
+        }
+        //a balanced binary tree is ceil(log2(n)) high, rotations keep this one within twice that
+        unsigned int bound = 2 * unsigned(ceil(log2(double(n))));
+        BvhStats s = line.stats(), g = grid.stats();
+        check(s.leaves == n && s.nodes == 2 * n - 1, "sorted tree holds every object", n);
+        check(s.height <= bound, "height after sorted insertion along a line", s.height);
+        check(g.height <= bound, "height after sorted insertion in a grid", g.height);
+    }
+}
+
+int main() {
+    testQueries();
+    testHeight();
+    printf("bvh_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
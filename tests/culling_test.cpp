@@ -0,0 +1,171 @@
+//
+//  culling_test.cpp
+//  BasicOpenGL
+//
+//  FrustumCuller against hand placed objects and against the plane test done one object at a time.
+//  Build it once as is and once with -U__SSE2__, both builds have to pass so the SSE and the scalar
+//  path of FrustumCuller::cull give the same answers.
+//
+
+#include <culling.h>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, unsigned int n) {
+    if (!ok) {
+        printf("FAILED: %s (%u)\n", what, n);
+        failures++;
+    }
+}
+
+static float uniform(float lo, float hi) {
+    return lo + (hi - lo) * (rand() / (float)RAND_MAX);
+}
+
+//inward facing, normalized planes of the frustum of vp, as FrameContext::frustum
+static void frustumPlanes(const glm::mat4& vp, glm::vec4 planes[6]) {
+    glm::vec4 row[4];
+    for (int i = 0; i < 4; i++) { row[i] = glm::vec4(vp[0][i], vp[1][i], vp[2][i], vp[3][i]); }
+    for (int i = 0; i < 3; i++) {
+        planes[2 * i] = row[3] + row[i];
+        planes[2 * i + 1] = row[3] - row[i];
+    }
+    for (int i = 0; i < 6; i++) { planes[i] /= glm::length(glm::vec3(planes[i])); }
+}
+
+struct Bounds {
+    glm::mat4 model;
+    glm::vec3 lo, hi;
+};
+
+//the test FrustumCuller runs, one object at a time, with the sums grouped the same way so the result is exact
+static bool expected(const Bounds& b, const glm::vec4 planes[6]) {
+    glm::vec3 center = (b.lo + b.hi) * 0.5f;
+    float radius = glm::length(b.hi - center);
+    glm::vec3 c = glm::vec3(b.model * glm::vec4(center, 1.0f));
+    float scale = max(glm::length(glm::vec3(b.model[0])), max(glm::length(glm::vec3(b.model[1])), glm::length(glm::vec3(b.model[2]))));
+    glm::vec3 lo, hi;
+    transformBox(b.model, b.lo, b.hi, lo, hi);
+    glm::vec3 bc = (lo + hi) * 0.5f, e = (hi - lo) * 0.5f;
+    for (int p = 0; p < 6; p++) {
+        float nx = planes[p].x, ny = planes[p].y, nz = planes[p].z, w = planes[p].w;
+        float sphere = ((nx * c.x + ny * c.y) + (nz * c.z + w)) + radius * scale;
+        float box = ((nx * bc.x + ny * bc.y) + (nz * bc.z + w)) + ((fabs(nx) * e.x + fabs(ny) * e.y) + fabs(nz) * e.z);
+        if (sphere < 0.0f || box < 0.0f) { return false; }
+    }
+    return true;
+}
+
+//whether every corner of the transformed box is outside one plane, so culling the object is right
+static bool outside(const Bounds& b, const glm::vec4 planes[6]) {
+    for (int p = 0; p < 6; p++) {
+        bool all = true;
+        for (int k = 0; k < 8 && all; k++) {
+            glm::vec3 v((k & 1) ? b.hi.x : b.lo.x, (k & 2) ? b.hi.y : b.lo.y, (k & 4) ? b.hi.z : b.lo.z);
+            glm::vec3 w = glm::vec3(b.model * glm::vec4(v, 1.0f));
+            all = glm::dot(glm::vec3(planes[p]), w) + planes[p].w < -1e-4f;
+        }
+        if (all) { return true; }
+    }
+    return false;
+}
+
+static CullStats cull(const vector<Bounds>& bounds, const glm::vec4 planes[6], vector<unsigned char>& inside) {
+    FrustumCuller culler;
+    culler.resize(bounds.size());
+    for (unsigned int i = 0; i < bounds.size(); i++) {
+        const Bounds& b = bounds[i];
+        glm::vec3 center = (b.lo + b.hi) * 0.5f;
+        culler.set(i, b.model, center, glm::length(b.hi - center), b.lo, b.hi);
+    }
+    return culler.cull(planes, inside);
+}
+
+//the unit box moved inside, across and outside each face of the box [-10, 10]^3
+static void testPlanes() {
+    glm::vec4 planes[6];
+    for (int i = 0; i < 3; i++) {
+        glm::vec3 n(0.0f);
+        n[i] = 1.0f;
+        planes[2 * i] = glm::vec4(n, 10.0f);
+        planes[2 * i + 1] = glm::vec4(-n, 10.0f);
+    }
+    //distance of the center from the origin along the plane's normal and whether the box is kept
+    const float distances[3] = {5.0f, 10.0f, 15.0f};
+    const bool kept[3] = {true, true, false};
+    vector<Bounds> bounds;
+    vector<bool> want;
+    for (int p = 0; p < 6; p++) {
+        for (int d = 0; d < 3; d++) {
+            Bounds b;
+            b.model = glm::translate(glm::mat4(1.0f), -glm::vec3(planes[p]) * distances[d]);
+            b.lo = glm::vec3(-1.0f);
+            b.hi = glm::vec3(1.0f);
+            bounds.push_back(b);
+            want.push_back(kept[d]);
+        }
+    }
+    //every prefix, so the last group of four is filled to each length
+    for (unsigned int n = 0; n <= bounds.size(); n++) {
+        vector<Bounds> prefix(bounds.begin(), bounds.begin() + n);
+        vector<unsigned char> inside;
+        CullStats stats = cull(prefix, planes, inside);
+        check(inside.size() == n && stats.tested == n, "every object tested", n);
+        unsigned int visible = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            check(inside[i] == want[i], "inside, straddling or outside a plane", i);
+            visible += want[i];
+        }
+        check(stats.visible == visible && stats.culled == n - visible, "counts leave out the padding", n);
+    }
+}
+
+//random objects around a perspective frustum, answers have to match the plane test exactly
+static void testRandom() {
+    srand(7);
+    glm::mat4 proj = glm::perspective(glm::radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, 10.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec4 planes[6];
+    frustumPlanes(proj * view, planes);
+    const unsigned int counts[] = {1, 2, 3, 5, 6, 7, 13, 1021, 20003};
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        unsigned int n = counts[c];
+        vector<Bounds> bounds(n);
+        for (unsigned int i = 0; i < n; i++) {
+            glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(uniform(-60.0f, 60.0f), uniform(-60.0f, 60.0f), uniform(-100.0f, 20.0f)));
+            m = glm::rotate(m, uniform(0.0f, 6.28f), glm::normalize(glm::vec3(uniform(-1.0f, 1.0f), uniform(-1.0f, 1.0f), uniform(0.1f, 1.0f))));
+            bounds[i].model = glm::scale(m, glm::vec3(uniform(0.2f, 3.0f), uniform(0.2f, 3.0f), uniform(0.2f, 3.0f)));
+            bounds[i].lo = glm::vec3(uniform(-2.0f, 0.0f), uniform(-2.0f, 0.0f), uniform(-2.0f, 0.0f));
+            bounds[i].hi = glm::vec3(uniform(0.0f, 2.0f), uniform(0.0f, 2.0f), uniform(0.0f, 2.0f));
+        }
+        vector<unsigned char> inside;
+        CullStats stats = cull(bounds, planes, inside);
+        unsigned int visible = 0, mismatched = 0, wrongly_culled = 0;
+        for (unsigned int i = 0; i < n; i++) {
+            mismatched += inside[i] != expected(bounds[i], planes);
+            wrongly_culled += !inside[i] && !outside(bounds[i], planes);
+            visible += inside[i];
+        }
+        check(mismatched == 0, "same answer as the plane test", n);
+        check(wrongly_culled == 0, "nothing visible culled", n);
+        check(stats.visible == visible && stats.culled == n - visible, "visible and culled counts", n);
+    }
+}
+
+int main() {
+    testPlanes();
+    testRandom();
+#ifdef CULL_SSE
+    printf("culling_test (sse): %s\n", failures ? "FAILED" : "passed");
+#else
+    printf("culling_test (scalar): %s\n", failures ? "FAILED" : "passed");
+#endif
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,80 @@
+//
+//  flat_shading_test.cpp
+//  BasicOpenGL
+//
+//  Flat primitives (PrimitiveKey::flat) keep the indexed smooth mesh and get their faceted look from the
+//  shader, faceted ones (facet()) give every corner of every triangle its own vertex. Both are uploaded
+//  and the flat one has to draw the same triangles from fewer bytes of buffers, see Mesh::gpuBytes.
+//  Needs a GL 3.3 context, the window stays hidden.
+//
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <primitive.h>
+
+#include <cstdio>
+
+using namespace std;
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, const char* shape) {
+    if (!ok) {
+        printf("FAILED: %s (%s)\n", what, shape);
+        failures++;
+    }
+}
+
+struct Case {
+    const char* name;
+    Shape sh;
+    unsigned int d1, d2;
+};
+
+int main() {
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "flat_shading_test", NULL, NULL);
+    if (!window) {
+        cerr << "flat_shading_test: no GL 3.3 context" << endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+
+    const Case cases[] = {
+        {"cuboid", CUBOID, 0, 0},
+        {"ellipsoid", ELLIPSOID, 32, 32},
+        {"cylinder", CYLINDER, 64, 0},
+        {"cone", CONE, 64, 0},
+        {"torus", TORUS, 32, 32},
+    };
+    printf("%-10s %10s %10s %10s %10s %7s\n", "primitive", "triangles", "flat B", "faceted B", "smooth B", "saved");
+    for (unsigned int c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const Case& t = cases[c];
+        PrimitiveKey k = Primitive::makeKey(t.sh, false, 2.0f, 1.5f, 1.0f, t.d1, t.d2);
+        PrimitiveKey smooth_key = Primitive::makeKey(t.sh, true, 2.0f, 1.5f, 1.0f, t.d1, t.d2);
+        Primitive faceted(k);
+        k.flat = true;
+        Primitive flat(k), smooth(smooth_key);
+        check(flat.flat && !faceted.flat, "only the flat key is flat", t.name);
+        check(flat.triangles() == faceted.triangles(), "same triangles", t.name);
+        check(flat.vertices.size() == smooth.vertices.size(), "flat keeps the vertices of the smooth mesh", t.name);
+        check(faceted.vertices.size() == faceted.indices.size(), "faceted has a vertex per corner", t.name);
+        check(flat.gpuBytes() == smooth.gpuBytes(), "flat uploads what the smooth mesh does", t.name);
+        check(flat.gpuBytes() < faceted.gpuBytes(), "flat uploads fewer bytes than faceted", t.name);
+        printf("%-10s %10u %10u %10u %10u %6.0f%%\n", t.name, flat.triangles(), unsigned(flat.gpuBytes()), unsigned(faceted.gpuBytes()),
+               unsigned(smooth.gpuBytes()), 100.0 * (1.0 - double(flat.gpuBytes()) / faceted.gpuBytes()));
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    printf("flat_shading_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
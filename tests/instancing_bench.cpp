@@ -0,0 +1,122 @@
+//
+//  instancing_bench.cpp
+//  BasicOpenGL
+//
+//  Draw calls and frame times of 1k, 10k, 50k and 100k copies of one primitive drawn one by one,
+//  instanced (see setInstancing) and, on GL 4.3, with glMultiDrawElementsIndirect (see
+//  setMultiDrawIndirect). Frustum culling is off so every object is submitted each frame. render ms is
+//  the CPU time of Scene::render submitting a frame, the speedup column compares it with drawing one by
+//  one. A frame is timed from clear to glFinish, so it covers the GPU work as well. Run it from the
+//  repository root, the scene loads its shaders from shaders/. Pass the number of frames to average,
+//  60 by default.
+//
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <scene.h>
+#include <camera.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+extern Camera CAMERA;
+extern const unsigned int SCR_WIDTH;
+extern const unsigned int SCR_HEIGHT;
+
+const unsigned int SCR_WIDTH = 800;
+const unsigned int SCR_HEIGHT = 600;
+Camera CAMERA(glm::vec3(0.0, 0.0, 0.0));
+
+enum Mode {ONE_BY_ONE, INSTANCED, INDIRECT, MODES};
+static const char* MODE_NAMES[MODES] = {"one by one", "instanced", "indirect"};
+
+//average milliseconds per frame of count objects drawn in mode, on the CPU in Scene::render and in all,
+//stats gets the last frame's numbers. False if the mode is not available
+static bool measure(Mode mode, unsigned int count, unsigned int frames, RenderStats& stats, double& render_ms, double& frame_ms) {
+    Scene scene;
+    scene.setFrustumCulling(false);
+    scene.setInstancing(mode == INSTANCED);
+    if (mode == INDIRECT && !scene.setMultiDrawIndirect(true, (GLADloadproc)glfwGetProcAddress)) { return false; }
+    scene.setSubd(4, 4);
+    scene.setRenderLights(false);
+    scene.createLight(DIRECTEDLIGHT, SlotMap<Object>::INVALID, {0.0, 0.0, 0.0}, {0.0, -1.0, -1.0});
+    //a cube of objects 3 units apart, the camera looks at it from the front
+    unsigned int side = unsigned(ceil(cbrt(double(count))));
+    for (unsigned int i = 0; i < count; i++) {
+        glm::vec3 cell(float(i % side), float(i / side % side), float(i / (side * side)));
+        scene.createObject(ELLIPSOID, cell * 3.0f);
+    }
+    float middle = 1.5f * (side - 1);
+    CAMERA.SetPosition(glm::vec3(middle, middle, 3.0f * side + 2.0f * middle));
+    CAMERA.SetOrientation(-90.0f, 0.0f);
+    //the first frames upload the batches and draw lists
+    for (unsigned int f = 0; f < 3; f++) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.render();
+    }
+    glFinish();
+    render_ms = 0;
+    chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+    for (unsigned int f = 0; f < frames; f++) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        scene.render();
+        render_ms += scene.stats.cpu_time;
+        glFinish();
+    }
+    frame_ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count() / frames;
+    render_ms /= frames;
+    stats = scene.stats;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    unsigned int frames = argc > 1 ? max(1, atoi(argv[1])) : 60;
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "instancing_bench", NULL, NULL);
+    if (!window) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "instancing_bench", NULL, NULL);
+    }
+    if (!window) {
+        cerr << "instancing_bench: no GL 3.3 context" << endl;
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(0);
+    gladLoadGLLoader((GLADloadproc)glfwGetProcAddress);
+    glEnable(GL_DEPTH_TEST);
+    glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+    printf("%-10s %7s %10s %9s %10s %8s %10s %9s\n", "mode", "objects", "draw calls", "batched", "render ms", "speedup", "frame ms", "fps");
+    const unsigned int counts[] = {1000, 10000, 50000, 100000};
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+        double one_by_one_ms = 0;
+        for (unsigned int m = 0; m < MODES; m++) {
+            RenderStats stats;
+            double render_ms, frame_ms;
+            if (!measure(Mode(m), counts[c], frames, stats, render_ms, frame_ms)) {
+                printf("%-10s %7u needs GL 4.3\n", MODE_NAMES[m], counts[c]);
+                continue;
+            }
+            if (m == ONE_BY_ONE) { one_by_one_ms = render_ms; }
+            //objects drawn through a batch, one instance or one indirect command each
+            printf("%-10s %7u %10u %9u %10.3f %7.1fx %10.3f %9.1f\n", MODE_NAMES[m], counts[c], stats.draw_calls, stats.instances + stats.indirect_commands,
+                   render_ms, one_by_one_ms / render_ms, frame_ms, 1000.0 / frame_ms);
+        }
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return 0;
+}
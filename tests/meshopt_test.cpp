@@ -0,0 +1,166 @@
+//
+//  meshopt_test.cpp
+//  BasicOpenGL
+//
+//  optimizeMesh on grids and spheres: the cache miss ratio of the FIFO simulator must not get worse,
+//  the vertex order must be a permutation and the triangles drawn must be the ones given.
+//
+
+#include <meshopt.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, const char* mesh) {
+    if (!ok) {
+        printf("FAILED: %s (%s)\n", what, mesh);
+        failures++;
+    }
+}
+
+struct TestMesh {
+    const char* name;
+    vector<glm::vec3> positions;
+    vector<unsigned int> indices;
+};
+
+//w by h quads in rows, two triangles each
+static TestMesh grid(unsigned int w, unsigned int h) {
+    TestMesh m;
+    m.name = "grid";
+    for (unsigned int y = 0; y <= h; y++) {
+        for (unsigned int x = 0; x <= w; x++) { m.positions.push_back(glm::vec3(float(x), float(y), 0.0f)); }
+    }
+    for (unsigned int y = 0; y < h; y++) {
+        for (unsigned int x = 0; x < w; x++) {
+            unsigned int a = y * (w + 1) + x, b = a + 1, c = a + w + 1, d = c + 1;
+            unsigned int quad[6] = {a, b, d, a, d, c};
+            m.indices.insert(m.indices.end(), quad, quad + 6);
+        }
+    }
+    return m;
+}
+
+//latitude longitude sphere, each ring wraps around to its first vertex and the poles are rings of
+//coincident vertices
+static TestMesh sphere(unsigned int stacks, unsigned int slices) {
+    TestMesh m;
+    m.name = "sphere";
+    for (unsigned int i = 0; i <= stacks; i++) {
+        float phi = 3.14159265f * i / stacks;
+        for (unsigned int j = 0; j < slices; j++) {
+            float theta = 6.2831853f * j / slices;
+            m.positions.push_back(glm::vec3(sin(phi) * cos(theta), cos(phi), sin(phi) * sin(theta)));
+        }
+    }
+    for (unsigned int i = 0; i < stacks; i++) {
+        for (unsigned int j = 0; j < slices; j++) {
+            unsigned int a = i * slices + j, b = i * slices + (j + 1) % slices, c = a + slices, d = b + slices;
+            if (i > 0) {
+                unsigned int top[3] = {a, b, c};
+                m.indices.insert(m.indices.end(), top, top + 3);
+            }
+            if (i + 1 < stacks) {
+                unsigned int bottom[3] = {b, d, c};
+                m.indices.insert(m.indices.end(), bottom, bottom + 3);
+            }
+        }
+    }
+    return m;
+}
+
+//the same triangles in random order, the case the optimizer has most to gain on
+static TestMesh shuffled(TestMesh m, const char* name) {
+    m.name = name;
+    unsigned int triangles = m.indices.size() / 3;
+    for (unsigned int t = triangles; t > 1; t--) {
+        unsigned int s = rand() % t;
+        for (unsigned int k = 0; k < 3; k++) { swap(m.indices[3 * (t - 1) + k], m.indices[3 * s + k]); }
+    }
+    return m;
+}
+
+//the triangles of indices in the old vertex numbers, each rotated to start at its smallest vertex so
+//the winding is kept, sorted
+static vector<vector<unsigned int> > triangleSet(const vector<unsigned int>& indices, const vector<unsigned int>* order) {
+    vector<vector<unsigned int> > set;
+    for (unsigned int t = 0; t < indices.size(); t += 3) {
+        vector<unsigned int> tri(3);
+        for (unsigned int k = 0; k < 3; k++) { tri[k] = order ? (*order)[indices[t + k]] : indices[t + k]; }
+        rotate(tri.begin(), min_element(tri.begin(), tri.end()), tri.end());
+        set.push_back(tri);
+    }
+    sort(set.begin(), set.end());
+    return set;
+}
+
+//optimize m with extra unreferenced vertices at the end, improved asks for a lower cache miss ratio
+static void testMesh(const TestMesh& m, unsigned int unused, bool improved) {
+    unsigned int vertex_count = m.positions.size() + unused;
+    vector<glm::vec3> positions(m.positions);
+    positions.resize(vertex_count, glm::vec3(0.0f));
+    vector<unsigned int> out, order;
+    MeshOptimization result = optimizeMesh(m.indices, vertex_count, &positions[0], sizeof(glm::vec3), out, order);
+
+    VertexCacheStats before = simulateVertexCache(m.indices, vertex_count), after = simulateVertexCache(out, vertex_count);
+    check(result.before.acmr == before.acmr && result.after.acmr == after.acmr, "reported ratios are the simulator's", m.name);
+    check(after.acmr <= before.acmr, "cache miss ratio does not get worse", m.name);
+    if (improved) { check(after.acmr < 0.8f * before.acmr, "cache miss ratio improves", m.name); }
+
+    check(order.size() == vertex_count, "one entry per vertex", m.name);
+    vector<bool> seen(vertex_count, false);
+    bool permutation = order.size() == vertex_count;
+    for (unsigned int i = 0; i < order.size() && permutation; i++) {
+        permutation = order[i] < vertex_count && !seen[order[i]];
+        seen[order[i]] = true;
+    }
+    check(permutation, "vertex order is a permutation", m.name);
+    for (unsigned int i = 0; i < unused && permutation; i++) {
+        check(order[vertex_count - unused + i] == m.positions.size() + i, "unreferenced vertices go last", m.name);
+    }
+    //first use order: new vertex i is first referenced before new vertex i + 1
+    unsigned int next = 0;
+    bool forward = true;
+    for (unsigned int i = 0; i < out.size(); i++) {
+        forward = forward && out[i] <= next;
+        if (out[i] == next) { next++; }
+    }
+    check(forward, "vertices numbered in the order they are first used", m.name);
+
+    check(out.size() == m.indices.size() && permutation && triangleSet(out, &order) == triangleSet(m.indices, NULL), "same triangles with the same winding", m.name);
+    printf("%-16s %6u triangles  ACMR %.3f -> %.3f  clusters %u\n", m.name, unsigned(m.indices.size() / 3), before.acmr, after.acmr, result.clusters);
+}
+
+static void testSimulator() {
+    unsigned int one[3] = {0, 1, 2}, two[6] = {0, 1, 2, 2, 1, 3};
+    check(simulateVertexCache(vector<unsigned int>(one, one + 3), 3).acmr == 3.0f, "a lone triangle misses three times", "simulator");
+    check(simulateVertexCache(vector<unsigned int>(two, two + 6), 4).acmr == 2.0f, "a second triangle reuses two vertices", "simulator");
+    //a fan around vertex 0 on a 4 entry FIFO: vertex 0 is evicted and transformed again every few triangles
+    vector<unsigned int> fan;
+    for (unsigned int i = 1; i <= 20; i++) {
+        unsigned int tri[3] = {0, i, i + 1};
+        fan.insert(fan.end(), tri, tri + 3);
+    }
+    VertexCacheStats s = simulateVertexCache(fan, 22, 4);
+    check(s.atvr >= 1.0f && s.acmr > 1.0f, "vertices evicted from a small cache are transformed again", "simulator");
+}
+
+int main() {
+    srand(5);
+    testSimulator();
+    testMesh(grid(64, 64), 0, false);
+    testMesh(grid(33, 7), 3, false);
+    testMesh(sphere(48, 64), 0, false);
+    testMesh(sphere(5, 7), 2, false);
+    testMesh(shuffled(grid(64, 64), "shuffled grid"), 0, true);
+    testMesh(shuffled(sphere(48, 64), "shuffled sphere"), 1, true);
+    printf("meshopt_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,89 @@
+//
+//  primitive_threads_bench.cpp
+//  BasicOpenGL
+//
+//  Build times of primitives on 1, 2, 4 and all hardware threads of the shared pool, from meshes small
+//  enough to be built on the calling thread alone (see Primitive::PARALLEL_GRAIN) to large ones. The
+//  meshes have to come out the same whatever the number of threads, the program fails otherwise.
+//  Pass the number of repetitions to keep the best time of, 5 by default.
+//
+
+#include <primitive.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+struct Build {
+    const char* name;
+    Shape sh;
+    bool smooth;
+    unsigned int subd;
+};
+
+//FNV-1a over the vertices and indices
+static unsigned long long checksum(const Primitive& p) {
+    unsigned long long h = 1469598103934665603ull;
+    const unsigned char* bytes[2] = {(const unsigned char*)p.vertices.data(), (const unsigned char*)p.indices.data()};
+    size_t sizes[2] = {p.vertices.size() * sizeof(Vertex), p.indices.size() * sizeof(unsigned int)};
+    for (int b = 0; b < 2; b++) {
+        for (size_t i = 0; i < sizes[b]; i++) { h = (h ^ bytes[b][i]) * 1099511628211ull; }
+    }
+    return h;
+}
+
+int main(int argc, char** argv) {
+    unsigned int repetitions = argc > 1 ? max(1, atoi(argv[1])) : 5;
+    unsigned int hardware = max(1u, thread::hardware_concurrency());
+    vector<unsigned int> threads;
+    const unsigned int counts[] = {1, 2, 4};
+    for (unsigned int i = 0; i < 3; i++) { threads.push_back(counts[i]); }
+    if (hardware != 1 && hardware != 2 && hardware != 4) { threads.push_back(hardware); }
+    const Build builds[] = {
+        {"smooth torus", TORUS, true, 8},
+        {"smooth torus", TORUS, true, 32},
+        {"smooth torus", TORUS, true, 128},
+        {"smooth torus", TORUS, true, 400},
+        {"faceted ellipsoid", ELLIPSOID, false, 8},
+        {"faceted ellipsoid", ELLIPSOID, false, 32},
+        {"faceted ellipsoid", ELLIPSOID, false, 128},
+        {"faceted ellipsoid", ELLIPSOID, false, 256},
+    };
+    printf("%u hardware threads, best of %u\n%-18s %5s %9s", hardware, repetitions, "primitive", "subd", "triangles");
+    for (unsigned int t = 0; t < threads.size(); t++) { printf("  %2u thr ms", threads[t]); }
+    printf("  speedup\n");
+    unsigned int mismatches = 0;
+    for (unsigned int b = 0; b < sizeof(builds) / sizeof(builds[0]); b++) {
+        const Build& build = builds[b];
+        PrimitiveKey k = Primitive::makeKey(build.sh, build.smooth, 2.0f, 1.5f, 0.5f, build.subd, build.subd);
+        unsigned long long first = 0;
+        unsigned int triangles = 0;
+        vector<double> best(threads.size(), 1e30);
+        for (unsigned int t = 0; t < threads.size(); t++) {
+            ThreadPool::shared().setThreads(threads[t]);
+            for (unsigned int r = 0; r < repetitions; r++) {
+                chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+                Primitive p(k, NO_UVMAP, false);
+                best[t] = min(best[t], chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count());
+                if (r) { continue; }
+                unsigned long long sum = checksum(p);
+                if (t == 0) {
+                    first = sum;
+                    triangles = p.indices.size() / 3;
+                } else if (sum != first) {
+                    printf("MISMATCH: %s subd %u differs on %u threads\n", build.name, build.subd, threads[t]);
+                    mismatches++;
+                }
+            }
+        }
+        printf("%-18s %5u %9u", build.name, build.subd, triangles);
+        for (unsigned int t = 0; t < threads.size(); t++) { printf("  %9.3f", best[t]); }
+        printf("  %6.2fx\n", best[0] / best.back());
+    }
+    ThreadPool::shared().setThreads(0);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,145 @@
+//
+//  ring_bench.cpp
+//  BasicOpenGL
+//
+//  The rings of an ellipsoid and of a torus generated by emitRing from a RingTable, against the per
+//  vertex generator it replaced, which solved every point with tan and sqrt in getEllipticCoord and once
+//  more for its normal. Both write into arrays sized beforehand so only the ring math is timed, on one
+//  thread. Both have to give the same vertices to within float rounding, the program fails otherwise.
+//  Pass the number of repetitions to keep the best time of, 5 by default.
+//
+
+#include <ring.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+using namespace std;
+
+//the generator before ring.h, as Primitive had it
+static glm::vec3 getEllipticCoord(float a, float b, float z, unsigned int i, unsigned int nxy) {
+    float pi = acos(-1), x, y;
+    if (i == nxy / 4 || i == 3 * nxy / 4) {
+        //to handle overflows at theta = pi/2 && theta = 3pi/2
+        x = 0.0; y = (i == nxy / 4 ? b : -b);
+    } else {
+        float theta = 2 * i * pi / nxy, m = tan(theta);
+        x = 1 / sqrt(1 / (a * a) + (double(m) * m) / (b * b));
+        if (pi / 2 < theta && theta < 3 * pi / 2) { x = -x; }
+        y = m * x;
+    }
+    return glm::vec3(x, y, z);
+}
+
+static glm::vec3 normals(float a, float b, float z, unsigned int i, unsigned int nxy, Normal n, float ca, float cb) {
+    switch(n) {
+        case TORUS_NORMAL : return glm::normalize(getEllipticCoord(a, b, z, i, nxy) - getEllipticCoord(ca, cb, 0, i, nxy));
+        case ELLIPSOID_NORMAL : return glm::normalize(getEllipticCoord(a, b, z, i, nxy));
+        default : return glm::vec3(0.0, 0.0, 1.0);
+    }
+}
+
+//the side of a primitive: rows rings of nxy vertices, from the half axes and height of each row
+struct Rows {
+    Normal normal;
+    float ca, cb;
+    vector<float> a, b, z;
+};
+
+static Rows ellipsoid(unsigned int subd, float x, float y, float h) {
+    Rows r = {ELLIPSOID_NORMAL, x, y};
+    unsigned int nz = 2 * (subd + 1);
+    float pi = acos(-1);
+    for (unsigned int i = 1; i < nz; i++) {
+        float z = h * sin(-pi / 2 + i * pi / nz), scale = sqrt(1 - (z * z) / (h * h));
+        r.a.push_back(x * scale);
+        r.b.push_back(y * scale);
+        r.z.push_back(z);
+    }
+    return r;
+}
+
+static Rows torus(unsigned int subd, float x, float y, float tube) {
+    Rows r = {TORUS_NORMAL, x, y};
+    unsigned int nz = 4 * (subd + 1);
+    float pi = acos(-1);
+    for (unsigned int i = 0; i < nz; i++) {
+        float theta = 2 * i * pi / nz;
+        r.a.push_back(x - tube * cos(theta));
+        r.b.push_back(y - tube * cos(theta));
+        r.z.push_back(tube * sin(theta));
+    }
+    return r;
+}
+
+static void perVertex(const Rows& r, unsigned int nxy, Vertex* out) {
+    for (unsigned int row = 0; row < r.z.size(); row++) {
+        for (unsigned int i = 0; i < nxy; i++) {
+            Vertex& v = out[row * nxy + i];
+            v.Position = getEllipticCoord(r.a[row], r.b[row], r.z[row], i, nxy);
+            v.Normal = normals(r.a[row], r.b[row], r.z[row], i, nxy, r.normal, r.ca, r.cb);
+        }
+    }
+}
+
+static void table(const Rows& r, unsigned int nxy, Vertex* out) {
+    RingTable ring(nxy);
+    for (unsigned int row = 0; row < r.z.size(); row++) {
+        emitRing(ring, r.a[row], r.b[row], r.z[row], r.normal, out + row * nxy, r.ca, r.cb);
+    }
+}
+
+struct Build {
+    const char* name;
+    bool torus;
+    unsigned int subd;
+};
+
+int main(int argc, char** argv) {
+    unsigned int repetitions = argc > 1 ? max(1, atoi(argv[1])) : 5;
+    const Build builds[] = {
+        {"ellipsoid", false, 10},
+        {"ellipsoid", false, 100},
+        {"ellipsoid", false, 500},
+        {"torus", true, 10},
+        {"torus", true, 100},
+        {"torus", true, 500},
+    };
+#ifdef RING_SSE
+    printf("emitRing with SSE, best of %u\n", repetitions);
+#else
+    printf("emitRing scalar, best of %u\n", repetitions);
+#endif
+    printf("%-10s %5s %9s %14s %10s %8s %10s\n", "primitive", "subd", "vertices", "per vertex ms", "table ms", "speedup", "max diff");
+    unsigned int mismatches = 0;
+    for (unsigned int b = 0; b < sizeof(builds) / sizeof(builds[0]); b++) {
+        const Build& build = builds[b];
+        Rows rows = build.torus ? torus(build.subd, 3.0f, 2.0f, 0.5f) : ellipsoid(build.subd, 2.0f, 1.5f, 0.5f);
+        unsigned int nxy = 4 * (build.subd + 1), count = nxy * rows.z.size();
+        vector<Vertex> old_vertices(count), new_vertices(count);
+        double best[2] = {1e30, 1e30};
+        for (unsigned int r = 0; r < repetitions; r++) {
+            chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+            perVertex(rows, nxy, &old_vertices[0]);
+            chrono::high_resolution_clock::time_point middle = chrono::high_resolution_clock::now();
+            table(rows, nxy, &new_vertices[0]);
+            chrono::high_resolution_clock::time_point end = chrono::high_resolution_clock::now();
+            best[0] = min(best[0], chrono::duration<double, milli>(middle - start).count());
+            best[1] = min(best[1], chrono::duration<double, milli>(end - middle).count());
+        }
+        float diff = 0;
+        for (unsigned int i = 0; i < count; i++) {
+            glm::vec3 dp = glm::abs(old_vertices[i].Position - new_vertices[i].Position), dn = glm::abs(old_vertices[i].Normal - new_vertices[i].Normal);
+            diff = max(diff, max(max(dp.x, max(dp.y, dp.z)), max(dn.x, max(dn.y, dn.z))));
+        }
+        if (!(diff <= 1e-5f)) {
+            printf("MISMATCH: %s subd %u differs from the per vertex generator by %g\n", build.name, build.subd, diff);
+            mismatches++;
+        }
+        printf("%-10s %5u %9u %14.3f %10.3f %7.2fx %10.2g\n", build.name, build.subd, count, best[0], best[1], best[0] / best[1], diff);
+    }
+    return mismatches ? 1 : 0;
+}
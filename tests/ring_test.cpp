@@ -0,0 +1,110 @@
+//
+//  ring_test.cpp
+//  BasicOpenGL
+//
+//  emitRing's SSE path against its scalar path, and both against the ring computed in double.
+//  A table of fewer than four directions is written by the scalar loop alone, so every vertex of a
+//  ring is emitted a second time from a table holding just its direction and both must give the
+//  same floats, bit for bit. Ring sizes that are not a multiple of four also run the scalar tail.
+//
+
+#include <ring.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, unsigned int n) {
+    if (!ok) {
+        printf("FAILED: %s (%u)\n", what, n);
+        failures++;
+    }
+}
+
+static bool same(const glm::vec3& u, const glm::vec3& v) {
+    return memcmp(&u, &v, sizeof(glm::vec3)) == 0;
+}
+
+//the vertex at direction (c, s) as the comment of emitRing defines it, in double
+static void reference(double c, double s, double a, double b, double z, Normal n, double ca, double cb, double p[3], double q[3]) {
+    double d = sqrt(b * b * c * c + a * a * s * s);
+    double r = d > 0 ? a * b / d : 0.0;
+    p[0] = r * c;
+    p[1] = r * s;
+    p[2] = z;
+    switch (n) {
+        case ELLIPSOID_NORMAL :
+        case CONE_NORMAL : { q[0] = p[0]; q[1] = p[1]; q[2] = z; break; }
+        case CYLINDER_NORMAL : { q[0] = 0; q[1] = 0; q[2] = z; break; }
+        case TORUS_NORMAL : {
+            double cd = sqrt(cb * cb * c * c + ca * ca * s * s);
+            double cr = cd > 0 ? ca * cb / cd : 0.0;
+            q[0] = p[0] - cr * c; q[1] = p[1] - cr * s; q[2] = z;
+            break;
+        }
+        default : { q[0] = 0; q[1] = 0; q[2] = 1; }
+    }
+    double len = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+    for (int k = 0; k < 3; k++) { q[k] /= len; }
+}
+
+struct Case {
+    float a, b, z;
+    Normal normal;
+    float ca, cb;
+};
+
+static void testRing(const RingTable& table, const Case& t) {
+    unsigned int n = table.size();
+    vector<Vertex> ring(n);
+    emitRing(table, t.a, t.b, t.z, t.normal, n ? &ring[0] : NULL, t.ca, t.cb);
+    unsigned int differs = 0, off = 0;
+    for (unsigned int i = 0; i < n; i++) {
+        RingTable single;
+        single.cosines.assign(1, table.cosines[i]);
+        single.sines.assign(1, table.sines[i]);
+        Vertex v;
+        emitRing(single, t.a, t.b, t.z, t.normal, &v, t.ca, t.cb);
+        differs += !same(v.Position, ring[i].Position) || !same(v.Normal, ring[i].Normal);
+        double p[3], q[3];
+        reference(table.cosines[i], table.sines[i], t.a, t.b, t.z, t.normal, t.ca, t.cb, p, q);
+        for (int k = 0; k < 3; k++) {
+            off += fabs(ring[i].Position[k] - p[k]) > 1e-5 * (1.0 + fabs(p[k]));
+            off += fabs(ring[i].Normal[k] - q[k]) > 1e-5;
+        }
+    }
+    check(differs == 0, "SSE and scalar paths give the same vertices", n);
+    check(off == 0, "vertices on the ring with unit normals", n);
+}
+
+int main() {
+    //every kind of normal on ellipses and a circle, and the apex of a cone where the ring collapses
+    const Case cases[] = {
+        {1.5f, 0.4f, 0.3f, ELLIPSOID_NORMAL, 1.5f, 0.4f},
+        {1.0f, 1.0f, -0.7f, CONE_NORMAL, 0.0f, 0.0f},
+        {2.0f, 0.5f, 1.0f, CYLINDER_NORMAL, 0.0f, 0.0f},
+        {0.8f, 2.5f, 0.0f, ELLIPTICAL_PLANE_NORMAL, 0.0f, 0.0f},
+        {0.0f, 0.0f, 1.0f, CONE_NORMAL, 0.0f, 0.0f},
+        {1.9f, 1.1f, 0.2f, TORUS_NORMAL, 1.5f, 0.8f},
+    };
+    const unsigned int sizes[] = {0, 1, 2, 3, 4, 5, 6, 7, 9, 13, 30, 63, 64, 101, 1022};
+    for (unsigned int s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        //the uniform table, and the curvature adapted one where the size allows it
+        RingTable uniform(sizes[s]), adapted(sizes[s], 1.5, 0.4);
+        for (unsigned int c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+            testRing(uniform, cases[c]);
+            testRing(adapted, cases[c]);
+        }
+    }
+#ifdef RING_SSE
+    printf("ring_test (sse): %s\n", failures ? "FAILED" : "passed");
+#else
+    printf("ring_test (scalar): %s\n", failures ? "FAILED" : "passed");
+#endif
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,179 @@
+//
+//  tessellation_test.cpp
+//  BasicOpenGL
+//
+//  Primitives built for a tessellation tolerance, see Primitive::fitTolerance, against their exact
+//  surfaces: every point of every triangle, and of every level of detail, has to lie within the
+//  tolerance of the surface. The subdivisions given in the keys are far too coarse, so a primitive
+//  that ignored its tolerance would fail.
+//
+
+#include <primitive.h>
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+using namespace std;
+
+static unsigned int failures = 0;
+
+static void check(bool ok, const char* what, const char* shape, float tolerance) {
+    if (!ok) {
+        printf("FAILED: %s (%s, %g)\n", what, shape, tolerance);
+        failures++;
+    }
+}
+
+//radius at polar angle phi of the ellipse with half axes x and y
+static double radius(double x, double y, double phi) {
+    return x * y / sqrt(y * y * cos(phi) * cos(phi) + x * x * sin(phi) * sin(phi));
+}
+
+//the exact surface of a primitive: its curved side by polar angle phi around the z axis, as the rings
+//place their vertices, and a second parameter along the side, plus the flat caps of cylinders and cones
+struct Surface {
+    Shape sh;
+    double a, b, c;
+
+    glm::dvec3 side(double phi, double t) const {
+        switch (sh) {
+            case ELLIPSOID: {
+                double r = cos(t) * radius(a, b, phi);
+                return glm::dvec3(r * cos(phi), r * sin(phi), c * sin(t));
+            }
+            case TORUS: {
+                double r = radius(a - c * cos(t), b - c * cos(t), phi);
+                return glm::dvec3(r * cos(phi), r * sin(phi), c * sin(t));
+            }
+            //t is the height from the base, the cone narrows to its apex at 2 c / 3
+            case CONE: {
+                double r = (1.0 - (t + c / 3) / c) * radius(a, b, phi);
+                return glm::dvec3(r * cos(phi), r * sin(phi), t);
+            }
+            default: {
+                double r = radius(a, b, phi);
+                return glm::dvec3(r * cos(phi), r * sin(phi), t);
+            }
+        }
+    }
+    //where the search for the closest point of the side to p starts
+    double start(const glm::dvec3& p, double phi) const {
+        double rho = sqrt(p.x * p.x + p.y * p.y);
+        switch (sh) {
+            case ELLIPSOID: { return atan2(p.z / c, rho / radius(a, b, phi)); }
+            case TORUS: { return atan2(p.z, radius(a, b, phi) - rho); }
+            default: { return p.z; }
+        }
+    }
+    //distance from p to the cap at height z, or to its plane outside the ellipse, which never wins
+    double cap(const glm::dvec3& p, double z) const {
+        bool inside = (p.x * p.x) / (a * a) + (p.y * p.y) / (b * b) <= 1.0 + 1e-9;
+        return inside ? fabs(p.z - z) : HUGE_VAL;
+    }
+    double distance(const glm::vec3& q) const {
+        glm::dvec3 p(q);
+        auto squared = [&](double u, double v) {
+            glm::dvec3 d = side(u, v) - p;
+            return glm::dot(d, d);
+        };
+        //the closest point need not be at the polar angle of p on flat ellipses, start from the best of
+        //a few angles around it
+        double phi = atan2(p.y, p.x), t = start(p, phi), f = squared(phi, t);
+        for (int k = -16; k <= 16; k++) {
+            double u = atan2(p.y, p.x) + k / 32.0, v = start(p, u), g = squared(u, v);
+            if (g < f) { phi = u; t = v; f = g; }
+        }
+        //Newton on the squared distance to the side, with central differences. Where the Hessian is not
+        //positive definite, far from the surface or near an axis, step down the gradient instead
+        const double h = 1e-5;
+        for (unsigned int k = 0; k < 100; k++) {
+            double fu0 = squared(phi - h, t), fu1 = squared(phi + h, t), fv0 = squared(phi, t - h), fv1 = squared(phi, t + h);
+            double gu = (fu1 - fu0) / (2 * h), gv = (fv1 - fv0) / (2 * h);
+            double huu = (fu1 - 2 * f + fu0) / (h * h), hvv = (fv1 - 2 * f + fv0) / (h * h);
+            double huv = (squared(phi + h, t + h) - squared(phi + h, t - h) - squared(phi - h, t + h) + squared(phi - h, t - h)) / (4 * h * h);
+            double det = huu * hvv - huv * huv, du, dv;
+            if (huu > 0 && det > 0) {
+                du = (hvv * gu - huv * gv) / det;
+                dv = (huu * gv - huv * gu) / det;
+            } else {
+                double g2 = gu * gu + gv * gv;
+                if (g2 == 0) { break; }
+                du = gu * f / g2;
+                dv = gv * f / g2;
+            }
+            //halve the step until it gets closer
+            double next = squared(phi - du, t - dv);
+            for (unsigned int halve = 0; next > f && halve < 30; halve++) {
+                du /= 2;
+                dv /= 2;
+                next = squared(phi - du, t - dv);
+            }
+            if (next > f) { break; }
+            phi -= du;
+            t -= dv;
+            f = next;
+            if (fabs(du) + fabs(dv) < 1e-12) { break; }
+        }
+        double d = sqrt(f);
+        if (sh == CYLINDER) { d = min(d, min(cap(p, -c / 2), cap(p, c / 2))); }
+        if (sh == CONE) { d = min(d, cap(p, -c / 3)); }
+        return d;
+    }
+};
+
+//largest distance between the triangles and the surface, measured at samples x samples points across
+//every triangle
+static float deviation(const Surface& s, const vector<Vertex>& vertices, const vector<unsigned int>& indices, unsigned int samples = 4) {
+    double worst = 0;
+    for (unsigned int t = 0; t + 2 < indices.size(); t += 3) {
+        glm::vec3 p0 = vertices[indices[t]].Position, p1 = vertices[indices[t + 1]].Position, p2 = vertices[indices[t + 2]].Position;
+        for (unsigned int i = 0; i <= samples; i++) {
+            for (unsigned int j = 0; i + j <= samples; j++) {
+                float u = float(i) / samples, v = float(j) / samples;
+                worst = max(worst, s.distance(p0 + u * (p1 - p0) + v * (p2 - p0)));
+            }
+        }
+    }
+    return float(worst);
+}
+
+struct Case {
+    const char* name;
+    Shape sh;
+    float a, b, c;
+};
+
+int main() {
+    const Case cases[] = {
+        {"sphere", ELLIPSOID, 1.0f, 1.0f, 1.0f},
+        {"ellipsoid", ELLIPSOID, 4.0f, 1.0f, 0.5f},
+        {"cylinder", CYLINDER, 3.0f, 0.7f, 2.0f},
+        {"cone", CONE, 2.0f, 0.6f, 3.0f},
+        {"torus", TORUS, 3.0f, 3.0f, 0.5f},
+        {"elliptic torus", TORUS, 6.0f, 2.0f, 0.3f},
+    };
+    const float tolerances[] = {0.1f, 0.02f, 0.004f};
+    for (unsigned int c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const Case& t = cases[c];
+        Surface surface = {t.sh, t.a, t.b, t.c};
+        for (unsigned int i = 0; i < sizeof(tolerances) / sizeof(tolerances[0]); i++) {
+            PrimitiveKey k = Primitive::makeKey(t.sh, true, t.a, t.b, t.c, 1, 1);
+            k.tolerance = tolerances[i];
+            k.lods = 2;
+            Primitive p(k, NO_UVMAP, false);
+            check(p.tolerance == tolerances[i] && p.chordError() == tolerances[i], "primitive keeps its tolerance", t.name, tolerances[i]);
+            float d = deviation(surface, p.vertices, p.indices);
+            check(d <= tolerances[i], "mesh within the tolerance", t.name, tolerances[i]);
+            printf("%-15s tolerance %-6g subd %3d %3d  deviation %.5f", t.name, tolerances[i], p.subd[0], p.subd[1], d);
+            for (unsigned int l = 0; l < p.lods.size(); l++) {
+                float e = deviation(surface, p.lods[l].vertices, p.lods[l].indices);
+                check(e <= p.lods[l].error, "level of detail within its error", t.name, p.lods[l].error);
+                printf("  level %u %.5f of %g", l + 1, e, p.lods[l].error);
+            }
+            printf("\n");
+        }
+    }
+    printf("tessellation_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}